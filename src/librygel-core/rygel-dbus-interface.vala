@@ -29,6 +29,20 @@ public interface Rygel.DBusInterface : Object {
     public abstract void shutdown () throws IOError, DBusError;
 }
 
+/**
+ * Run-time statistics, exported next to DBusInterface on its object path.
+ */
+[DBus (name = "org.gnome.Rygel1.Statistics1")]
+public interface Rygel.DBusStatistics : Object {
+    public const string INTERFACE_NAME = "org.gnome.Rygel1.Statistics1";
+
+    /**
+     * Get the run-time statistics collected by Rygel.Statistics.
+     */
+    public abstract HashTable<string, Variant> get_statistics ()
+                                        throws IOError, DBusError;
+}
+
 [DBus (name = "org.gnome.Rygel1.AclProvider1")]
 public interface Rygel.DBusAclProvider : Object {
     public const string SERVICE_NAME = "org.gnome.Rygel1.AclProvider1";
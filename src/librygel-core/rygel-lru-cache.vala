@@ -0,0 +1,180 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * A map that drops its least recently used entries.
+ *
+ * Looking up, adding and evicting entries takes constant time.
+ */
+public class Rygel.LruCache<K, V> : GLib.Object {
+    private class Node<K, V> {
+        public K key;
+        public V value;
+        public unowned Node<K, V>? older;
+        public unowned Node<K, V>? newer;
+    }
+
+    // Owns the nodes, the links between them are unowned
+    private HashMap<K, Node<K, V>> nodes;
+    private unowned Node<K, V>? oldest;
+    private unowned Node<K, V>? newest;
+
+    /**
+     * The maximum number of entries, or 0 if the owner evicts entries
+     * itself.
+     */
+    public uint capacity { get; private set; }
+
+    public int size {
+        get {
+            return this.nodes.size;
+        }
+    }
+
+    public bool is_empty {
+        get {
+            return this.nodes.is_empty;
+        }
+    }
+
+    public LruCache (uint capacity = 0) {
+        this.capacity = capacity;
+        this.nodes = new HashMap<K, Node<K, V>> ();
+    }
+
+    public bool has_key (K key) {
+        return this.nodes.has_key (key);
+    }
+
+    /**
+     * Get the value of @key and mark it as most recently used.
+     *
+     * @return the value, or null if @key is not in the cache
+     */
+    public new V? get (K key) {
+        var node = this.nodes[key];
+        if (node == null) {
+            return null;
+        }
+
+        this.unlink (node);
+        this.link (node);
+
+        return node.value;
+    }
+
+    /**
+     * Add or replace the value of @key and mark it as most recently used.
+     *
+     * If the cache is full, the least recently used entry is dropped.
+     */
+    public new void set (K key, V value) {
+        var node = this.nodes[key];
+        if (node != null) {
+            node.value = value;
+            this.unlink (node);
+            this.link (node);
+
+            return;
+        }
+
+        if (this.capacity > 0 && this.nodes.size >= this.capacity) {
+            this.evict ();
+        }
+
+        node = new Node<K, V> ();
+        node.key = key;
+        node.value = value;
+        this.nodes[key] = node;
+        this.link (node);
+    }
+
+    /**
+     * Remove @key from the cache.
+     *
+     * @return true if @key was in the cache
+     */
+    public bool unset (K key, out V? value = null) {
+        Node<K, V> node;
+        if (!this.nodes.unset (key, out node)) {
+            value = null;
+
+            return false;
+        }
+
+        this.unlink (node);
+        value = node.value;
+
+        return true;
+    }
+
+    /**
+     * Remove the least recently used entry.
+     *
+     * @return false if the cache is empty
+     */
+    public bool evict (out V? value = null) {
+        if (this.oldest == null) {
+            value = null;
+
+            return false;
+        }
+
+        K key = this.oldest.key;
+
+        return this.unset (key, out value);
+    }
+
+    public void clear () {
+        this.oldest = null;
+        this.newest = null;
+        this.nodes.clear ();
+    }
+
+    private void link (Node<K, V> node) {
+        node.older = this.newest;
+        node.newer = null;
+
+        if (this.newest != null) {
+            this.newest.newer = node;
+        } else {
+            this.oldest = node;
+        }
+
+        this.newest = node;
+    }
+
+    private void unlink (Node<K, V> node) {
+        if (node.older != null) {
+            node.older.newer = node.newer;
+        } else {
+            this.oldest = node.newer;
+        }
+
+        if (node.newer != null) {
+            node.newer.older = node.older;
+        } else {
+            this.newest = node.older;
+        }
+
+        node.older = null;
+        node.newer = null;
+    }
+}
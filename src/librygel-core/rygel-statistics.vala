@@ -0,0 +1,84 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * Something collecting run-time statistics, such as query timings of a
+ * database.
+ */
+public interface Rygel.StatisticsProvider : GLib.Object {
+    /**
+     * Get a snapshot of the statistics.
+     *
+     * @return the statistics, usually a dictionary of type a{sv}
+     */
+    public abstract Variant get_statistics ();
+}
+
+/**
+ * Keeps the statistics providers of the server and its plugins.
+ *
+ * The statistics are available on the D-Bus interface of the server.
+ */
+public class Rygel.Statistics : GLib.Object {
+    // Our singleton
+    private static Statistics instance;
+
+    private HashMap<string, StatisticsProvider> providers;
+
+    private Statistics () {
+        this.providers = new HashMap<string, StatisticsProvider> ();
+    }
+
+    public static Statistics get_default () {
+        if (Statistics.instance == null) {
+            Statistics.instance = new Statistics ();
+        }
+
+        return Statistics.instance;
+    }
+
+    /**
+     * Make the statistics of @provider available under @name.
+     *
+     * A provider registered before under the same name is replaced.
+     */
+    public void register (string name, StatisticsProvider provider) {
+        this.providers[name] = provider;
+    }
+
+    public void unregister (string name) {
+        this.providers.unset (name);
+    }
+
+    /**
+     * Collect the statistics of all providers.
+     *
+     * @return a dictionary of the statistics by provider name
+     */
+    public HashTable<string, Variant> collect () {
+        var result = new HashTable<string, Variant> (str_hash, str_equal);
+
+        foreach (var entry in this.providers) {
+            result.insert (entry.key, entry.value.get_statistics ());
+        }
+
+        return result;
+    }
+}
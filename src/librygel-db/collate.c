@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2012 Jens Georg <mail@jensge.org>.
+ *
+ * Author: Jens Georg <mail@jensge.org>
+ *
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <sqlite3.h>
+
+#if HAVE_UNISTRING
+#   include <unistr.h>
+#endif
+
+gint rygel_database_utf8_collate_str (const char *a, gint alen,
+                                      const char *b, gint blen)
+{
+    char *a_str, *b_str;
+    gint result;
+
+    /* Make sure the passed strings are null terminated */
+    a_str = g_strndup (a, alen);
+    b_str = g_strndup (b, blen);
+
+#if HAVE_UNISTRING
+    result = u8_strcoll ((const uint8_t *) a_str, (const uint8_t *) b_str);
+#else
+    result = g_utf8_collate (a_str, b_str);
+#endif
+
+    g_free (a_str);
+    g_free (b_str);
+
+    return result;
+}
+
+/*
+ * SQL function collate_key(text). Returns a key for text that sorts with
+ * plain byte comparison (BINARY collation) like the text sorts with
+ * g_utf8_collate ().
+ */
+void rygel_database_utf8_collate_key (sqlite3_context *context,
+                                      int              argc,
+                                      sqlite3_value  **argv)
+{
+    const char *text;
+
+    text = (const char *) sqlite3_value_text (argv[0]);
+    if (text == NULL) {
+        sqlite3_result_null (context);
+
+        return;
+    }
+
+    sqlite3_result_text (context,
+                         g_utf8_collate_key (text,
+                                             sqlite3_value_bytes (argv[0])),
+                         -1,
+                         g_free);
+}
@@ -27,6 +27,13 @@ public class Rygel.Database.Cursor : Object {
     private int current_state = -1;
     private bool dirty = true;
     private unowned Sqlite.Database db;
+    private Database? owner;
+    private Profile? profile;
+    private int64 step_time;
+    // Whether the statement ran since the last record_profile (); cheap
+    // steps may take less than the resolution of the clock
+    private bool stepped;
+    private uint64 rows;
 
     /**
      * Prepare a SQLite statement from a SQL string
@@ -54,6 +61,44 @@ public class Rygel.Database.Cursor : Object {
         this.bind (arguments);
     }
 
+    /**
+     * Create a cursor using the statement cache of @owner
+     *
+     * If @owner has an idle statement for @sql cached, it is re-used instead
+     * of preparing a new one. The statement is handed back to @owner when the
+     * cursor is destroyed.
+     */
+    internal Cursor.cached (Database          owner,
+                            Sqlite.Database   db,
+                            string            sql,
+                            GLib.Value[]?     arguments) throws DatabaseError {
+        this.db = db;
+        this.owner = owner;
+        this.profile = owner.profile;
+
+        this.statement = owner.take_statement (sql);
+        if (this.statement == null) {
+            this.throw_if_code_is_error (db.prepare_v2 (sql,
+                                                        -1,
+                                                        out this.statement,
+                                                        null));
+        }
+
+        if (arguments == null) {
+            return;
+        }
+
+        this.bind (arguments);
+    }
+
+    ~Cursor () {
+        this.record_profile ();
+
+        if (this.owner != null && this.statement != null) {
+            this.owner.release_statement ((owned) this.statement);
+        }
+    }
+
     /**
      * Bind new values to a cursor.
      *
@@ -69,6 +114,7 @@ public class Rygel.Database.Cursor : Object {
      * none
      */
     public void bind (GLib.Value[]? arguments) throws DatabaseError {
+        this.record_profile ();
         this.statement.reset ();
         this.dirty = true;
         this.current_state = -1;
@@ -109,6 +155,74 @@ public class Rygel.Database.Cursor : Object {
         }
     }
 
+    /**
+     * Bind an integer to the parameter at @index.
+     *
+     * Unlike bind (), the typed bind functions neither reset the cursor nor
+     * need the value boxed in a GValue. They are meant to be called on a
+     * cursor fresh from Database.prepare (), before reading its rows.
+     *
+     * @param index position of the parameter, starting at 1 like in SQLite
+     * @param value the value to bind
+     */
+    public void bind_int64 (int index, int64 value) throws DatabaseError {
+        this.check_bind (index, this.statement.bind_int64 (index, value));
+    }
+
+    /**
+     * Bind a string to the parameter at @index.
+     *
+     * @param index position of the parameter, starting at 1 like in SQLite
+     * @param value the value to bind; null binds NULL
+     */
+    public void bind_text (int index, string? value) throws DatabaseError {
+        if (value == null) {
+            this.bind_null (index);
+
+            return;
+        }
+
+        this.check_bind (index, this.statement.bind_text (index, value));
+    }
+
+    /**
+     * Bind NULL to the parameter at @index.
+     *
+     * @param index position of the parameter, starting at 1 like in SQLite
+     */
+    public void bind_null (int index) throws DatabaseError {
+        this.check_bind (index, this.statement.bind_null (index));
+    }
+
+    /**
+     * Step through all rows, for statements whose result is not needed.
+     */
+    public void run () throws DatabaseError {
+        while (this.has_next ()) {
+            this.next ();
+        }
+    }
+
+    private void record_profile () {
+        if (this.profile == null || !this.stepped) {
+            return;
+        }
+
+        this.profile.record (this.statement, this.step_time, this.rows);
+        this.stepped = false;
+        this.step_time = 0;
+        this.rows = 0;
+    }
+
+    private void check_bind (int index, int result) throws DatabaseError {
+        if (result != Sqlite.OK) {
+            throw new DatabaseError.BIND ("Failed to bind value %d in %s: %s",
+                                          index,
+                                          this.statement.sql (),
+                                          this.db.errmsg ());
+        }
+    }
+
     /**
      * Check if the cursor has more rows left
      *
@@ -116,7 +230,17 @@ public class Rygel.Database.Cursor : Object {
      */
     public bool has_next () throws DatabaseError {
         if (this.dirty) {
-            this.current_state = this.statement.step ();
+            if (this.profile != null) {
+                var start = get_monotonic_time ();
+                this.current_state = this.statement.step ();
+                this.step_time += get_monotonic_time () - start;
+                this.stepped = true;
+                if (this.current_state == Sqlite.ROW) {
+                    this.rows++;
+                }
+            } else {
+                this.current_state = this.statement.step ();
+            }
             this.dirty = false;
         }
 
@@ -0,0 +1,228 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+using Sqlite;
+
+/**
+ * Execution statistics of the statements run on a database.
+ *
+ * Statements are grouped by label. SQL starting with a C-style comment is
+ * counted under the text of that comment, such as the name of a query
+ * template, any other SQL under the statement itself. Only the time spent
+ * stepping through the result is counted, not what the caller does with the
+ * rows.
+ *
+ * A profile may be shared by several connections on different threads.
+ */
+public class Rygel.Database.Profile : Object, StatisticsProvider {
+    // Latencies are counted in buckets of powers of two microseconds
+    private const int BUCKETS = 32;
+
+    private class Entry {
+        public uint64 count;
+        public int64 total_time;
+        public int64 max_time;
+        public uint64 rows;
+        public int64 full_scan_steps;
+        public int64 sorts;
+        public int64 auto_indices;
+        public int64 vm_steps;
+        public uint64[] histogram = new uint64[BUCKETS];
+
+        /**
+         * Get an upper bound of the latency below which @fraction of the
+         * runs completed.
+         */
+        public int64 percentile (double fraction) {
+            var wanted = (uint64) (this.count * fraction);
+            if (wanted < this.count * fraction) {
+                wanted++;
+            }
+            uint64 seen = 0;
+
+            for (var i = 0; i < BUCKETS; i++) {
+                seen += this.histogram[i];
+                if (seen >= wanted) {
+                    return int64.min ((int64) 1 << (i + 1), this.max_time);
+                }
+            }
+
+            return this.max_time;
+        }
+    }
+
+    private Mutex mutex;
+    private HashMap<string, Entry> entries;
+
+    public Profile () {
+        this.entries = new HashMap<string, Entry> ();
+    }
+
+    /**
+     * Account a run of @statement.
+     *
+     * This also resets the counters of @statement.
+     *
+     * @param statement the statement that was run
+     * @param time microseconds spent in stepping @statement
+     * @param rows number of result rows
+     */
+    internal void record (Statement statement, int64 time, uint64 rows) {
+        var label = Profile.get_label (statement.sql ());
+
+        this.mutex.lock ();
+        var entry = this.entries[label];
+        if (entry == null) {
+            entry = new Entry ();
+            this.entries[label] = entry;
+        }
+
+        entry.count++;
+        entry.total_time += time;
+        entry.max_time = int64.max (entry.max_time, time);
+        entry.rows += rows;
+        entry.full_scan_steps += statement.status
+                                        (StatementStatus.FULLSCAN_STEP, 1);
+        entry.sorts += statement.status (StatementStatus.SORT, 1);
+        entry.auto_indices += statement.status (StatementStatus.AUTOINDEX, 1);
+        entry.vm_steps += statement.status (StatementStatus.VM_STEP, 1);
+
+        var bucket = 0;
+        for (var t = time; t > 1 && bucket < BUCKETS - 1; t >>= 1) {
+            bucket++;
+        }
+        entry.histogram[bucket]++;
+        this.mutex.unlock ();
+    }
+
+    /**
+     * Forget everything recorded so far.
+     */
+    public void clear () {
+        this.mutex.lock ();
+        this.entries.clear ();
+        this.mutex.unlock ();
+    }
+
+    /**
+     * Get the statistics of all labels.
+     *
+     * @return a dictionary of type a{sa{sv}}, with count, total-us, p50-us,
+     * p90-us, p99-us, max-us, rows, full-scan-steps, sorts, auto-indices and
+     * vm-steps for each label
+     */
+    public Variant get_statistics () {
+        var builder = new VariantBuilder (new VariantType ("a{sa{sv}}"));
+
+        this.mutex.lock ();
+        foreach (var entry in this.entries) {
+            var value = entry.value;
+            var details = new VariantBuilder (new VariantType ("a{sv}"));
+            details.add ("{sv}", "count", new Variant.uint64 (value.count));
+            details.add ("{sv}",
+                         "total-us",
+                         new Variant.int64 (value.total_time));
+            details.add ("{sv}",
+                         "p50-us",
+                         new Variant.int64 (value.percentile (0.5)));
+            details.add ("{sv}",
+                         "p90-us",
+                         new Variant.int64 (value.percentile (0.9)));
+            details.add ("{sv}",
+                         "p99-us",
+                         new Variant.int64 (value.percentile (0.99)));
+            details.add ("{sv}",
+                         "max-us",
+                         new Variant.int64 (value.max_time));
+            details.add ("{sv}", "rows", new Variant.uint64 (value.rows));
+            details.add ("{sv}",
+                         "full-scan-steps",
+                         new Variant.int64 (value.full_scan_steps));
+            details.add ("{sv}", "sorts", new Variant.int64 (value.sorts));
+            details.add ("{sv}",
+                         "auto-indices",
+                         new Variant.int64 (value.auto_indices));
+            details.add ("{sv}",
+                         "vm-steps",
+                         new Variant.int64 (value.vm_steps));
+            builder.add ("{sa{sv}}", entry.key, details);
+        }
+        this.mutex.unlock ();
+
+        return builder.end ();
+    }
+
+    /**
+     * Print the statistics of all labels to the debug log, most expensive
+     * first.
+     */
+    public void dump () {
+        var labels = new ArrayList<string> ();
+        var lines = new HashMap<string, string> ();
+        var times = new HashMap<string, int64?> ();
+
+        this.mutex.lock ();
+        foreach (var entry in this.entries) {
+            var value = entry.value;
+            labels.add (entry.key);
+            times[entry.key] = value.total_time;
+            lines[entry.key] = ("%s: %llu runs, %lld µs total, " +
+                                "p50 %lld µs, p99 %lld µs, max %lld µs, " +
+                                "%llu rows, %lld full scan steps, " +
+                                "%lld sorts, %lld automatic indices").printf
+                                        (entry.key,
+                                         value.count,
+                                         value.total_time,
+                                         value.percentile (0.5),
+                                         value.percentile (0.99),
+                                         value.max_time,
+                                         value.rows,
+                                         value.full_scan_steps,
+                                         value.sorts,
+                                         value.auto_indices);
+        }
+        this.mutex.unlock ();
+
+        labels.sort ((a, b) => {
+            int64 time_a = times[a];
+            int64 time_b = times[b];
+            if (time_a == time_b) {
+                return 0;
+            }
+
+            return time_a > time_b ? -1 : 1;
+        });
+
+        debug ("Query profile:");
+        foreach (var label in labels) {
+            debug ("%s", lines[label]);
+        }
+    }
+
+    private static string get_label (string sql) {
+        if (sql.has_prefix ("/* ")) {
+            var end = sql.index_of (" */");
+            if (end > 0) {
+                return sql.substring (3, end - 3);
+            }
+        }
+
+        return sql;
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Worker threads running read-only functions on a database.
+ *
+ * Each worker uses a read-only connection of its own, so in write-ahead log
+ * mode readers neither block each other nor the writer.
+ */
+internal class Rygel.Database.ReadPool : Object {
+    private class Job {
+        public ReadFunc func;
+        public Cancellable? cancellable;
+        public MainContext context;
+        public SourceFunc callback;
+        public Error? error;
+    }
+
+    private AsyncQueue<Database> connections;
+    // Holds a reference on the pool until it is stopped
+    private ThreadPool<Job>? workers;
+
+    /**
+     * Open @size read-only connections to the database at @path.
+     *
+     * The connections are opened right away so that any error shows up here
+     * and not on the first query.
+     *
+     * @param profile where the connections account their statements, or null
+     */
+    public ReadPool (string path, uint size, Profile? profile) throws Error {
+        this.connections = new AsyncQueue<Database> ();
+        for (var i = 0; i < size; i++) {
+            var connection = new Database (path,
+                                           Flavor.FOREIGN,
+                                           Flags.READ_ONLY);
+            connection.profile = profile;
+            this.connections.push (connection);
+        }
+
+        this.workers = new ThreadPool<Job>.with_owned_data (this.run_job,
+                                                            (int) size,
+                                                            false);
+    }
+
+    /**
+     * Run @func on one of the workers.
+     *
+     * The call completes in the thread-default main context of the caller.
+     */
+    public async void run (owned ReadFunc func,
+                           Cancellable?   cancellable) throws Error {
+        var job = new Job ();
+        job.func = (owned) func;
+        job.cancellable = cancellable;
+        job.context = MainContext.ref_thread_default ();
+        job.callback = this.run.callback;
+
+        if (this.workers == null) {
+            throw new IOError.CLOSED ("Read pool was stopped");
+        }
+
+        this.workers.add (job);
+        yield;
+
+        if (job.error != null) {
+            throw job.error.copy ();
+        }
+    }
+
+    /**
+     * Wait for the queued jobs and close the connections.
+     *
+     * The pool is not usable afterwards.
+     */
+    public void stop () {
+        if (this.workers == null) {
+            return;
+        }
+
+        ThreadPool.free ((owned) this.workers, false, true);
+
+        while (this.connections.try_pop () != null) { }
+    }
+
+    private void run_job (owned Job job) {
+        if (job.cancellable != null && job.cancellable.is_cancelled ()) {
+            job.error = new IOError.CANCELLED ("Operation was cancelled");
+        } else {
+            var connection = this.connections.pop ();
+            try {
+                job.func (connection);
+            } catch (Error error) {
+                job.error = error;
+            }
+            this.connections.push (connection);
+        }
+
+        var source = new IdleSource ();
+        source.set_callback ((owned) job.callback);
+        source.attach (job.context);
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Sqlite;
+
+/**
+ * Read access to the columns of a result row.
+ *
+ * The accessors mirror those of Sqlite.Statement, so code decoding a row
+ * does not need to know whether it reads from a statement or from a copy
+ * of the row.
+ */
+public interface Rygel.Database.Row : Object {
+    public abstract int column_type (int column);
+    public abstract unowned string? column_text (int column);
+    public abstract int64 column_int64 (int column);
+
+    public int column_int (int column) {
+        return (int) this.column_int64 (column);
+    }
+}
+
+/**
+ * Row reading the current row of a statement.
+ *
+ * The row is only valid until the statement is stepped again.
+ */
+public class Rygel.Database.StatementRow : Object, Row {
+    private unowned Statement statement;
+
+    public StatementRow (Statement statement) {
+        this.statement = statement;
+    }
+
+    public int column_type (int column) {
+        return this.statement.column_type (column);
+    }
+
+    public unowned string? column_text (int column) {
+        return this.statement.column_text (column);
+    }
+
+    public int64 column_int64 (int column) {
+        return this.statement.column_int64 (column);
+    }
+}
+
+/**
+ * Copy of a result row which stays valid after the statement moved on.
+ *
+ * This is used to hand rows read on a worker thread to the main loop. All
+ * text columns are packed into one buffer, so a row costs a fixed number of
+ * allocations however many columns it has, and column_text () points into
+ * that buffer without copying.
+ */
+public class Rygel.Database.RowSnapshot : Object, Row {
+    private int[] types;
+    private int64[] integers;
+    // Start of each text column in text, or -1
+    private int[] offsets;
+    private uint8[] text;
+    // Integer columns read as text, converted on demand
+    private string?[] converted;
+
+    public RowSnapshot (Statement statement) {
+        var count = statement.column_count ();
+
+        this.types = new int[count];
+        this.integers = new int64[count];
+        this.offsets = new int[count];
+
+        var length = 0;
+        for (var i = 0; i < count; i++) {
+            this.types[i] = statement.column_type (i);
+            this.offsets[i] = -1;
+            switch (this.types[i]) {
+                case Sqlite.NULL:
+                    break;
+                case Sqlite.INTEGER:
+                    this.integers[i] = statement.column_int64 (i);
+                    break;
+                default:
+                    this.integers[i] = statement.column_int64 (i);
+                    // column_text () before column_bytes (), as the latter
+                    // depends on the conversion done by the former
+                    statement.column_text (i);
+                    this.offsets[i] = length;
+                    length += statement.column_bytes (i) + 1;
+                    break;
+            }
+        }
+
+        this.text = new uint8[length];
+        for (var i = 0; i < count; i++) {
+            if (this.offsets[i] < 0) {
+                continue;
+            }
+
+            var bytes = statement.column_bytes (i);
+            Memory.copy (&this.text[this.offsets[i]],
+                         statement.column_text (i),
+                         bytes);
+            this.text[this.offsets[i] + bytes] = 0;
+        }
+    }
+
+    public int column_type (int column) {
+        return this.types[column];
+    }
+
+    public unowned string? column_text (int column) {
+        var offset = this.offsets[column];
+        if (offset >= 0) {
+            return (string) (&this.text[offset]);
+        }
+
+        // Like SQLite, convert integers to text on demand
+        if (this.types[column] != Sqlite.INTEGER) {
+            return null;
+        }
+
+        if (this.converted == null) {
+            this.converted = new string?[this.types.length];
+        }
+
+        if (this.converted[column] == null) {
+            this.converted[column] = this.integers[column].to_string ();
+        }
+
+        return this.converted[column];
+    }
+
+    public int64 column_int64 (int column) {
+        return this.integers[column];
+    }
+}
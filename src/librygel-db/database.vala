@@ -51,6 +51,18 @@ namespace Rygel.Database {
     /// Prototype for UTF-8 collation function
     extern static int utf8_collate_str (uint8[] a, uint8[] b);
 
+    /// Prototype for the SQL function 'collate_key'
+    extern static void utf8_collate_key (Sqlite.Context context,
+                                         [CCode (array_length_pos = 1.1)]
+                                         Sqlite.Value[] args);
+
+    /**
+     * Function run by Database.read () with a read-only connection.
+     *
+     * @param connection the connection to run queries on
+     */
+    public delegate void ReadFunc (Database connection) throws Error;
+
     /**
      * Special GValue to pass to exec or exec_cursor to bind a column to
      * NULL
@@ -140,6 +152,39 @@ public class Rygel.Database.Database : Object, Initable {
     }
 
     private Sqlite.Database db;
+    private string path;
+    private ReadPool? readers;
+
+    /// Maximum number of idle prepared statements kept around
+    private const uint STATEMENT_CACHE_SIZE = 64;
+
+    private class CachedStatement {
+        public Statement statement;
+
+        public CachedStatement (owned Statement statement) {
+            this.statement = (owned) statement;
+        }
+    }
+
+    private LruCache<string, CachedStatement> statements;
+
+    /**
+     * Where to account the statements run on this database, or null to not
+     * profile them.
+     *
+     * Set this before start_readers () to include the workers.
+     */
+    public Profile? profile { get; set; default = null; }
+
+    /**
+     * Number of cursors that could re-use a cached prepared statement
+     */
+    public uint statement_cache_hits { get; private set; default = 0; }
+
+    /**
+     * Number of cursors that needed to prepare a new statement
+     */
+    public uint statement_cache_misses { get; private set; default = 0; }
 
     /**
      * Connect to a SQLite database file
@@ -164,7 +209,11 @@ public class Rygel.Database.Database : Object, Initable {
      * @throws DatabaseError if anything goes wrong
      */
     public bool init (Cancellable? cancellable = null) throws Error {
+        this.statements = new LruCache<string, CachedStatement>
+                                        (STATEMENT_CACHE_SIZE);
+
         var path = this.build_path ();
+        this.path = path;
         if (flags == Flags.READ_ONLY) {
             Sqlite.Database.open_v2 (path, out this.db, Sqlite.OPEN_READONLY);
         } else {
@@ -196,6 +245,14 @@ public class Rygel.Database.Database : Object, Initable {
                                  null,
                                  null);
 
+        this.db.create_function ("collate_key",
+                                 1,
+                                 Sqlite.UTF8,
+                                 null,
+                                 utf8_collate_key,
+                                 null,
+                                 null);
+
         this.db.create_collation ("CASEFOLD",
                                   Sqlite.UTF8,
                                   Database.utf8_collate);
@@ -212,10 +269,63 @@ public class Rygel.Database.Database : Object, Initable {
         return true;
     }
 
+    ~Database () {
+        // The worker pool references itself until it is stopped
+        this.stop_readers ();
+
+        // Finalize all cached statements before the connection is closed,
+        // sqlite3_close () refuses to close a database with pending
+        // statements.
+        if (this.statements != null) {
+            this.statements.clear ();
+        }
+    }
+
     private void on_trace (string message) {
         debug ("SQLITE: %s", message);
     }
 
+    /**
+     * Take an idle prepared statement for @sql out of the cache.
+     *
+     * The statement is removed from the cache while in use so that nested
+     * cursors on the same SQL get a statement of their own.
+     *
+     * @return the cached statement or null if it needs to be prepared
+     */
+    internal Statement? take_statement (string sql) {
+        CachedStatement entry;
+
+        if (!this.statements.unset (sql, out entry)) {
+            this.statement_cache_misses++;
+
+            return null;
+        }
+
+        this.statement_cache_hits++;
+
+        return (owned) entry.statement;
+    }
+
+    /**
+     * Put a statement that is no longer used by a cursor back into the cache.
+     *
+     * If there is already an idle statement for the same SQL (because of
+     * nested cursors), the statement is finalized instead.
+     */
+    internal void release_statement (owned Statement statement) {
+        // Reset releases any read lock the statement might still hold
+        statement.reset ();
+        statement.clear_bindings ();
+
+        var sql = statement.sql ();
+        if (this.statements.has_key (sql)) {
+            return;
+        }
+
+        this.statements[sql] = new CachedStatement ((owned) statement);
+    }
+
     /**
      * SQL query function.
      *
@@ -228,7 +338,81 @@ public class Rygel.Database.Database : Object, Initable {
     public Cursor exec_cursor (string        sql,
                                GLib.Value[]? arguments = null)
                                throws DatabaseError {
-        return new Cursor (this.db, sql, arguments);
+        return new Cursor.cached (this, this.db, sql, arguments);
+    }
+
+    /**
+     * Prepare @sql for the typed bind functions of Cursor.
+     *
+     * This avoids boxing every argument in a GValue, which adds up for
+     * statements run once per object.
+     *
+     * @param sql The SQL query to run.
+     * @return a cursor with no values bound yet
+     * @throws DatabaseError if the underlying SQLite operation fails.
+     */
+    public Cursor prepare (string sql) throws DatabaseError {
+        return new Cursor.cached (this, this.db, sql, null);
+    }
+
+    /**
+     * Serve read () from worker threads.
+     *
+     * Each of the @size workers gets a read-only connection of its own.
+     * Readers only run concurrently with the writer in write-ahead log mode,
+     * so this does nothing unless the database was opened with
+     * Flags.SHARED. All modifications still go through this connection,
+     * which serializes them.
+     *
+     * @param size number of worker threads
+     * @throws DatabaseError if a read-only connection could not be opened
+     */
+    public void start_readers (uint size) throws Error {
+        if (size == 0 ||
+            !(Flags.SHARED in this.flags) ||
+            this.path == ":memory:") {
+            return;
+        }
+
+        this.readers = new ReadPool (this.path, size, this.profile);
+    }
+
+    /**
+     * Stop the workers started with start_readers ().
+     *
+     * This waits for all queued reads to finish and closes the read-only
+     * connections. Later calls to read () run on this connection.
+     */
+    public void stop_readers () {
+        if (this.readers == null) {
+            return;
+        }
+
+        this.readers.stop ();
+        this.readers = null;
+    }
+
+    /**
+     * Run @func with a read-only connection on a worker thread.
+     *
+     * @func must only use the connection it is passed and not touch any
+     * state of the main loop. If there are no workers, @func is called with
+     * this connection right away.
+     *
+     * @param func the function running the queries
+     * @param cancellable a cancellable to skip @func if it has not started yet
+     * @throws Error any error thrown by @func
+     */
+    public async void read (owned ReadFunc func,
+                            Cancellable?   cancellable = null)
+                            throws Error {
+        if (this.readers == null) {
+            func (this);
+
+            return;
+        }
+
+        yield this.readers.run ((owned) func, cancellable);
     }
 
     /**
@@ -253,10 +437,7 @@ public class Rygel.Database.Database : Object, Initable {
             return;
         }
 
-        var cursor = this.exec_cursor (sql, arguments);
-        while (cursor.has_next ()) {
-            cursor.next ();
-        }
+        this.exec_cursor (sql, arguments).run ();
     }
 
     /**
@@ -67,15 +67,21 @@ public class Rygel.ContentDirectory: Service {
     protected string feature_list;
 
     internal HTTPServer http_server;
+    internal DIDLFragmentCache didl_fragments;
+    internal SearchCriteriaCache search_criteria;
 
     public MediaContainer root_container;
-    private ArrayList<MediaContainer> updated_containers;
+    // Containers updated since the last ContainerUpdateIDs event, by id
+    private HashMap<string, UpdatedContainer> updated_containers;
+    private uint64 container_update_serial;
+    private string container_update_ids;
 
     private ArrayList<ImportResource> active_imports;
     private ArrayList<ImportResource> finished_imports;
 
     private bool clear_updated_containers;
-    private uint update_notify_id;
+    private EventModerator update_ids_events;
+    private EventModerator last_change_events;
 
     internal Cancellable cancellable;
 
@@ -85,6 +91,17 @@ public class Rygel.ContentDirectory: Service {
 
     private string service_reset_token;
 
+    // Minimum time between two events of a moderated state variable in
+    // milliseconds, as given by the UPnP device architecture
+    private const int EVENT_INTERVAL = 200;
+    // Upper limit for backing off the event interval during bulk changes
+    private const int MAX_EVENT_INTERVAL = 5000;
+
+    private class UpdatedContainer {
+        public MediaContainer container;
+        public uint64 serial;
+    }
+
     public override void constructed () {
         base.constructed ();
 
@@ -94,9 +111,12 @@ public class Rygel.ContentDirectory: Service {
 
         this.root_container = plugin.root_container;
         this.http_server = new HTTPServer (this, plugin.name);
+        this.didl_fragments = new DIDLFragmentCache
+                                        (this.root_container is
+                                         TrackableContainer);
+        this.search_criteria = new SearchCriteriaCache ();
 
-        this.updated_containers = new ArrayList<MediaContainer>
-                                        (MediaContainer.equal_func);
+        this.updated_containers = new HashMap<string, UpdatedContainer> ();
         this.active_imports = new ArrayList<ImportResource> ();
         this.finished_imports = new ArrayList<ImportResource> ();
 
@@ -115,6 +135,31 @@ public class Rygel.ContentDirectory: Service {
 
         this.last_change = new LastChange ();
 
+        var min_interval = EVENT_INTERVAL;
+        var max_interval = MAX_EVENT_INTERVAL;
+        try {
+            var config = MetaConfig.get_default ();
+            min_interval = config.get_int ("general",
+                                           "event-interval",
+                                           EVENT_INTERVAL,
+                                           int.MAX);
+        } catch (Error error) { }
+
+        try {
+            var config = MetaConfig.get_default ();
+            max_interval = config.get_int ("general",
+                                           "max-event-interval",
+                                           EVENT_INTERVAL,
+                                           int.MAX);
+        } catch (Error error) { }
+
+        this.update_ids_events = new EventModerator (min_interval,
+                                                     max_interval);
+        this.update_ids_events.send.connect (this.notify_update_ids);
+        this.last_change_events = new EventModerator (min_interval,
+                                                      max_interval);
+        this.last_change_events.send.connect (this.notify_last_change);
+
         this.feature_list =
             "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" +
             "<Features xmlns=\"urn:schemas-upnp-org:av:avs\" " +
@@ -414,18 +459,31 @@ public class Rygel.ContentDirectory: Service {
         value.set_string (this.feature_list);
     }
 
-    private string create_container_update_ids () {
-        var update_ids = "";
+    private unowned string create_container_update_ids () {
+        if (this.container_update_ids != null) {
+            return this.container_update_ids;
+        }
+
+        // Send the containers in the order of their last update
+        var updates = new ArrayList<UpdatedContainer> ();
+        updates.add_all (this.updated_containers.values);
+        updates.sort ((a, b) => {
+            return a.serial < b.serial ? -1 : (a.serial > b.serial ? 1 : 0);
+        });
 
-        foreach (var container in this.updated_containers) {
-            if (update_ids != "") {
-                update_ids += ",";
+        var update_ids = new StringBuilder ();
+        foreach (var update in updates) {
+            if (update_ids.len > 0) {
+                update_ids.append_c (',');
             }
 
-            update_ids += container.id + "," + container.update_id.to_string ();
+            update_ids.append_printf ("%s,%u",
+                                      update.container.id,
+                                      update.container.update_id);
         }
+        this.container_update_ids = (owned) update_ids.str;
 
-        return update_ids;
+        return this.container_update_ids;
     }
 
     private bool handle_system_update () {
@@ -497,22 +555,30 @@ public class Rygel.ContentDirectory: Service {
 
         // UPnP specs dicate we make sure only last update be evented
         if (updated) {
-            this.updated_containers.remove (updated_container);
-            this.updated_containers.add (updated_container);
+            this.add_updated_container (updated_container);
         }
 
         if (is_container) {
-            MediaContainer container = object as MediaContainer;
+            this.add_updated_container (object as MediaContainer);
+        }
+        this.container_update_ids = null;
+    }
 
-            this.updated_containers.remove (container);
-            this.updated_containers.add (container);
+    private void add_updated_container (MediaContainer container) {
+        var update = this.updated_containers[container.id];
+        if (update == null) {
+            update = new UpdatedContainer ();
+            this.updated_containers[container.id] = update;
         }
+
+        update.container = container;
+        update.serial = ++this.container_update_serial;
     }
 
     /**
      * handler for container_updated signal on root_container. We don't
-     * immediately send the notification for changes but schedule the
-     * notification after 0.2 seconds. Also we don't clear the updated
+     * immediately send the notification for changes but schedule it through
+     * the event moderators, see EventModerator. Also we don't clear the updated
      * container list immediately after notification but rather in this
      * function. Please refer to ContentDirectory version 2 specs for details
      * on why we do all this the way we do.
@@ -537,7 +603,7 @@ public class Rygel.ContentDirectory: Service {
         handle_container_update_ids (changed ? updated_container : null,
                                      object);
 
-        this.ensure_timeout ();
+        this.update_ids_events.schedule ();
     }
 
     private void on_sub_tree_updates_finished (MediaContainer root_container,
@@ -548,21 +614,22 @@ public class Rygel.ContentDirectory: Service {
                                           this.system_update_id);
 
         this.last_change.add_event (entry);
-        this.ensure_timeout ();
+        this.last_change_events.schedule ();
     }
 
-    private bool update_notify () {
+    private void notify_update_ids () {
         var update_ids = this.create_container_update_ids ();
 
         this.notify ("ContainerUpdateIDs", typeof (string), update_ids);
         this.notify ("SystemUpdateID", typeof (uint32), this.system_update_id);
-        this.notify ("LastChange", typeof (string), this.last_change.get_log ());
 
         this.clear_updated_containers = true;
-        this.update_notify_id = 0;
-        this.last_change.clear_on_new_event ();
+    }
 
-        return false;
+    private void notify_last_change () {
+        this.notify ("LastChange", typeof (string), this.last_change.get_log ());
+
+        this.last_change.clear_on_new_event ();
     }
 
     private string create_transfer_ids () {
@@ -650,12 +717,6 @@ public class Rygel.ContentDirectory: Service {
         value.set_string (this.last_change.get_log ());
     }
 
-    private void ensure_timeout () {
-        if (this.update_notify_id == 0) {
-            this.update_notify_id = Timeout.add (200, this.update_notify);
-        }
-    }
-
     private void add_last_change_entry (MediaObject object,
                                         ObjectEventType event_type,
                                         bool sub_tree_update) {
@@ -687,6 +748,7 @@ public class Rygel.ContentDirectory: Service {
         }
 
         this.last_change.add_event (entry);
+        this.last_change_events.schedule ();
     }
 
     /* ServiceResetToken */
@@ -31,6 +31,7 @@ internal class Rygel.DataSink : Object {
     private DataSource source;
     private Server server;
     private ServerMessage message;
+    private RequestTrace? trace;
 
     private const uint MAX_BUFFERED_CHUNKS = 32;
     private const uint MIN_BUFFERED_CHUNKS = 4;
@@ -42,10 +43,12 @@ internal class Rygel.DataSink : Object {
     public DataSink (DataSource source,
                      Server     server,
                      ServerMessage message,
-                     HTTPSeekRequest?  offsets) {
+                     HTTPSeekRequest?  offsets,
+                     RequestTrace? trace) {
         this.source = source;
         this.server = server;
         this.message = message;
+        this.trace = trace;
 
         this.chunks_buffered = 0;
         this.bytes_sent = 0;
@@ -60,6 +63,9 @@ internal class Rygel.DataSink : Object {
         this.chunks_buffered--;
         if (this.chunks_buffered < MIN_BUFFERED_CHUNKS) {
             this.source.thaw ();
+            if (this.trace != null) {
+                this.trace.thaw ();
+            }
         }
     }
 
@@ -75,11 +81,17 @@ internal class Rygel.DataSink : Object {
         this.message.get_response_body ().append_take (buffer[0:to_send]);
         this.chunks_buffered++;
         this.bytes_sent += to_send;
+        if (this.trace != null) {
+            this.trace.sent (to_send);
+        }
 
         this.message.unpause ();
 
         if (this.chunks_buffered > MAX_BUFFERED_CHUNKS) {
             this.source.freeze ();
+            if (this.trace != null) {
+                this.trace.freeze ();
+            }
         }
     }
 
@@ -0,0 +1,270 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * Serialized DIDL-Lite of recently served objects.
+ *
+ * Building the DIDL-Lite of an object, including its resources, and
+ * filtering it is expensive, and clients tend to fetch the same lists over
+ * and over. Each object is therefore serialized on its own and the result
+ * kept per object update id, attached thumbnails and subtitles, client hacks
+ * and filter. A response is then put together from the serialized objects.
+ *
+ * If the root container does not track changes, object update ids are not
+ * maintained, so everything is dropped whenever the system update id
+ * changes instead.
+ *
+ * Only one object is held as a DOM at any time; its text is written to the
+ * response right away. Responses with many objects are not cached, so a
+ * client browsing everything neither keeps all of it in memory nor pushes
+ * everything else out of the cache.
+ */
+internal class Rygel.DIDLFragmentCache : Object {
+    // Fragments are kept in two generations; when the current one is full,
+    // the previous one is dropped. Fragments used from the previous
+    // generation move to the current one.
+    private const int GENERATION_SIZE = 2048;
+    // Responses with more objects are not cached
+    private const int MAX_CACHED_RESPONSE = GENERATION_SIZE / 4;
+
+    private const string ROOT_START = "<DIDL-Lite";
+    private const string ROOT_END = "</DIDL-Lite>";
+
+    private class Fragment {
+        // Namespace declarations needed by xml
+        public string[] namespaces;
+        public string xml;
+    }
+
+    private HashMap<string, Fragment> current;
+    private HashMap<string, Fragment> previous;
+    private bool track_changes;
+    private uint32 system_update_id;
+
+    public DIDLFragmentCache (bool track_changes) {
+        this.track_changes = track_changes;
+        this.current = new HashMap<string, Fragment> ();
+        this.previous = new HashMap<string, Fragment> ();
+    }
+
+    /**
+     * Serialize @objects to a DIDL-Lite document.
+     *
+     * @param objects the objects to serialize, released when done so they
+     * are gone before the response is sent
+     * @param http_server the server providing the resources of the objects
+     * @param hacks hacks for the client or null
+     * @param filter the filter requested by the client
+     * @param system_update_id the current system update id
+     * @return the DIDL-Lite document
+     */
+    public string serialize (owned MediaObjects objects,
+                             HTTPServer   http_server,
+                             ClientHacks? hacks,
+                             string       filter,
+                             uint32       system_update_id) throws Error {
+        if (!this.track_changes &&
+            system_update_id != this.system_update_id) {
+            this.current.clear ();
+            this.previous.clear ();
+            this.system_update_id = system_update_id;
+        }
+
+        if (objects.is_empty) {
+            var serializer = new Serializer (SerializerType.GENERIC_DIDL);
+            serializer.filter (filter);
+
+            return serializer.get_string ();
+        }
+
+        var hacks_name = hacks == null ? "" : hacks.get_type ().name ();
+        var cacheable = objects.size <= MAX_CACHED_RESPONSE;
+        var namespaces = new ArrayList<string> ();
+        var document = new StringBuilder (ROOT_START);
+        document.append_c ('>');
+
+        foreach (var object in objects) {
+            string key = null;
+            Fragment fragment = null;
+
+            if (cacheable) {
+                key = DIDLFragmentCache.make_key (object, hacks_name, filter);
+            }
+
+            if (key != null) {
+                fragment = this.lookup (key);
+            }
+
+            if (fragment == null) {
+                fragment = DIDLFragmentCache.create_fragment (object,
+                                                              http_server,
+                                                              hacks,
+                                                              filter);
+                if (key != null) {
+                    this.store (key, fragment);
+                }
+            }
+
+            foreach (var name_space in fragment.namespaces) {
+                if (!namespaces.contains (name_space)) {
+                    namespaces.add (name_space);
+                }
+            }
+            document.append (fragment.xml);
+        }
+        document.append (ROOT_END);
+        objects = null;
+
+        // The namespace declarations of the root element are only known
+        // once all objects are written
+        var root = new StringBuilder ();
+        foreach (var name_space in namespaces) {
+            root.append_c (' ');
+            root.append (name_space);
+        }
+        document.insert (ROOT_START.length, root.str);
+
+        // Take the buffer instead of copying a possibly huge string
+        return (owned) document.str;
+    }
+
+    /**
+     * Make the cache key for the fragment of @object.
+     *
+     * Thumbnails, album art and subtitles are looked up when the object is
+     * built and may show up later without a new object update id, so they
+     * are part of the key.
+     *
+     * @return the key, or null if the fragment should not be cached because
+     * a thumbnail is still being generated
+     */
+    private static string? make_key (MediaObject object,
+                                     string      hacks_name,
+                                     string      filter) {
+        var key = new StringBuilder (object.id);
+        key.append_printf ("\n%u", object.object_update_id);
+
+        var visual = object as VisualItem;
+        if (visual != null) {
+            foreach (var thumbnail in visual.thumbnails) {
+                if (thumbnail.size < 0) {
+                    return null;
+                }
+
+                DIDLFragmentCache.append_icon (key, thumbnail);
+            }
+        }
+
+        var music = object as MusicItem;
+        if (music != null && music.album_art != null) {
+            DIDLFragmentCache.append_icon (key, music.album_art);
+        }
+
+        var video = object as VideoItem;
+        if (video != null) {
+            foreach (var subtitle in video.subtitles) {
+                key.append_printf ("\n%s %lld", subtitle.uri, subtitle.size);
+            }
+        }
+
+        // Containers show their child count and update ids
+        var container = object as MediaContainer;
+        if (container != null) {
+            key.append_printf ("\n%d\n%u\n%lld",
+                               container.child_count,
+                               container.update_id,
+                               container.total_deleted_child_count);
+        }
+
+        key.append_c ('\n');
+        key.append (hacks_name);
+        key.append_c ('\n');
+        key.append (filter);
+
+        return key.str;
+    }
+
+    private static void append_icon (StringBuilder key, IconInfo icon) {
+        key.append_printf ("\n%s %lld %dx%d",
+                           icon.uri,
+                           icon.size,
+                           icon.width,
+                           icon.height);
+    }
+
+    private static Fragment create_fragment (MediaObject  object,
+                                             HTTPServer   http_server,
+                                             ClientHacks? hacks,
+                                             string       filter)
+                                             throws Error {
+        if (hacks != null) {
+            hacks.apply (object);
+        }
+
+        var serializer = new Serializer (SerializerType.GENERIC_DIDL);
+        object.serialize (serializer, http_server);
+        serializer.filter (filter);
+        var document = serializer.get_string ();
+
+        // Split the document into the namespace declarations of the root
+        // element and its content
+        var fragment = new Fragment ();
+        var root_end = document.index_of_char ('>');
+        var content_end = document.last_index_of (ROOT_END);
+        if (!document.has_prefix (ROOT_START) ||
+            root_end < 0 ||
+            content_end < root_end) {
+            fragment.namespaces = {};
+            fragment.xml = "";
+
+            return fragment;
+        }
+
+        fragment.namespaces = document.slice (ROOT_START.length, root_end)
+                                      .strip ()
+                                      .split (" ");
+        fragment.xml = document.slice (root_end + 1, content_end);
+
+        return fragment;
+    }
+
+    private Fragment? lookup (string key) {
+        var fragment = this.current[key];
+        if (fragment != null) {
+            return fragment;
+        }
+
+        fragment = this.previous[key];
+        if (fragment != null) {
+            this.store (key, fragment);
+        }
+
+        return fragment;
+    }
+
+    private void store (string key, Fragment fragment) {
+        if (this.current.size >= GENERATION_SIZE) {
+            this.previous = this.current;
+            this.current = new HashMap<string, Fragment> ();
+        }
+
+        this.current[key] = fragment;
+    }
+}
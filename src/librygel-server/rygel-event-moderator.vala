@@ -0,0 +1,81 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Rate limiting of a moderated state variable.
+ *
+ * A change schedules an event, which is sent once the current interval has
+ * passed; further changes until then go into the same event. If changes
+ * keep coming in right after each event, as during the harvest of a large
+ * library, the interval doubles up to a maximum, so subscribers get a few
+ * big events instead of a steady stream of small ones. Once there were no
+ * changes for a whole interval, it drops back to the minimum.
+ */
+internal class Rygel.EventModerator : Object {
+    /**
+     * Emitted when the event should be sent.
+     */
+    public signal void send ();
+
+    private uint min_interval;
+    private uint max_interval;
+    private uint interval;
+    private uint timeout_id;
+    // Monotonic time of the last event in microseconds, 0 if none was sent
+    private int64 last_sent;
+
+    /**
+     * @param min_interval the minimum time between two events in
+     * milliseconds
+     * @param max_interval the maximum time the interval is backed off to
+     */
+    public EventModerator (uint min_interval, uint max_interval) {
+        this.min_interval = min_interval;
+        this.max_interval = uint.max (min_interval, max_interval);
+        this.interval = min_interval;
+    }
+
+    /**
+     * Schedule an event for a change, unless one is already pending.
+     */
+    public void schedule () {
+        if (this.timeout_id != 0) {
+            return;
+        }
+
+        if (this.last_sent != 0) {
+            var quiet = (get_monotonic_time () - this.last_sent) / 1000;
+            if (quiet < this.interval) {
+                this.interval = uint.min (this.interval * 2,
+                                          this.max_interval);
+            } else {
+                this.interval = this.min_interval;
+            }
+        }
+
+        this.timeout_id = Timeout.add (this.interval, this.on_timeout);
+    }
+
+    private bool on_timeout () {
+        this.timeout_id = 0;
+        this.last_sent = get_monotonic_time ();
+        this.send ();
+
+        return false;
+    }
+}
@@ -67,9 +67,12 @@ public class Rygel.HTTPGet : HTTPRequest {
                                                          uri.resource_name,
                                                          this.cancellable);
         } else if (uri.thumbnail_index >= 0) {
-            this.handler = new HTTPThumbnailHandler (this.object as MediaFileItem,
-                                                     uri.thumbnail_index,
-                                                     this.cancellable);
+            var thumbnail_handler = new HTTPThumbnailHandler
+                                        (this.object as MediaFileItem,
+                                         uri.thumbnail_index,
+                                         this.cancellable);
+            yield thumbnail_handler.ensure_thumbnail ();
+            this.handler = thumbnail_handler;
         } else if (uri.subtitle_index >= 0) {
             this.handler = new HTTPSubtitleHandler (this.object as MediaFileItem,
                                                     uri.subtitle_index,
@@ -95,6 +98,10 @@ public class Rygel.HTTPGet : HTTPRequest {
             }
         }
 
+        if (this.trace != null) {
+            this.trace.mark ("handler");
+        }
+
         yield this.handle_item_request ();
     }
 
@@ -231,6 +238,19 @@ public class Rygel.HTTPGet : HTTPRequest {
         this.msg.get_response_headers ().append ("Server",
                                           this.http_server.server_name);
 
+        // Small thumbnails are answered from memory
+        var thumbnail_handler = this.handler as HTTPThumbnailHandler;
+        if (thumbnail_handler != null &&
+            this.seek == null &&
+            this.speed_request == null) {
+            var body = yield thumbnail_handler.get_cached_body ();
+            if (body != null) {
+                this.send_cached_body (body);
+
+                return;
+            }
+        }
+
         var response = this.handler.render_body (this);
 
         // Have the response process the seek/speed request
@@ -253,6 +273,10 @@ public class Rygel.HTTPGet : HTTPRequest {
             return;
         }
 
+        if (this.trace != null) {
+            this.trace.mark ("preroll");
+        }
+
         // Determine the size value
         int64 response_size;
         {
@@ -361,8 +385,50 @@ public class Rygel.HTTPGet : HTTPRequest {
             return;
         }
 
+        // Thumbnails and subtitles are not worth mentioning
+        var root_container = this.http_server.root_container;
+        var is_stream = this.handler is HTTPMediaResourceHandler;
+        if (is_stream) {
+            root_container.stream_started (this.object);
+        }
+
         yield response.run ();
 
+        if (is_stream) {
+            root_container.stream_finished (this.object);
+        }
+
+        this.end (Soup.Status.NONE);
+    }
+
+    private void send_cached_body (ThumbnailCache.Entry body) {
+        var response_headers = this.msg.get_response_headers ();
+        response_headers.replace ("ETag", body.etag);
+        response_headers.replace ("Last-Modified", body.last_modified);
+
+        if (msg.get_http_version () == Soup.HTTPVersion.@1_0) {
+            // Set the response version to HTTP 1.1 (see DLNA 7.5.4.3.2.7.2)
+            msg.set_http_version (Soup.HTTPVersion.@1_1);
+            response_headers.append ("Connection", "close");
+        }
+
+        if (body.is_fresh (this.msg.get_request_headers ())) {
+            this.msg.set_status (Soup.Status.NOT_MODIFIED, null);
+        } else {
+            var size = body.data.get_size ();
+            response_headers.set_content_length ((int64) size);
+            this.msg.set_status (Soup.Status.OK, null);
+            if (this.msg.get_method () != "HEAD") {
+                var response_body = this.msg.get_response_body ();
+                response_body.append_bytes (body.data);
+                response_body.complete ();
+                if (this.trace != null) {
+                    this.trace.sent ((int64) size);
+                }
+            }
+        }
+
+        this.msg.unpause ();
         this.end (Soup.Status.NONE);
     }
 }
@@ -48,6 +48,9 @@ public abstract class Rygel.HTTPRequest : GLib.Object, Rygel.StateMachine {
 
     internal ClientHacks hack;
 
+    // Only set if request metrics are enabled
+    internal RequestTrace? trace;
+
     protected HTTPRequest (HTTPServer   http_server,
                            Soup.Server  server,
                            Soup.ServerMessage msg) {
@@ -60,6 +63,13 @@ public abstract class Rygel.HTTPRequest : GLib.Object, Rygel.StateMachine {
         try {
             this.hack = ClientHacks.create (msg);
         } catch (Error error) { }
+
+        var metrics = RequestMetrics.get_default ();
+        if (metrics != null) {
+            this.trace = new RequestTrace (metrics,
+                                           "http-" + msg.get_method ().down (),
+                                           this.hack);
+        }
     }
 
     public async void run () {
@@ -79,6 +89,9 @@ public abstract class Rygel.HTTPRequest : GLib.Object, Rygel.StateMachine {
             this.uri = new HTTPItemURI.from_string (path, this.http_server);
 
             yield this.find_item ();
+            if (this.trace != null) {
+                this.trace.mark ("find-item");
+            }
 
             yield this.handle ();
         } catch (Error error) {
@@ -92,9 +105,15 @@ public abstract class Rygel.HTTPRequest : GLib.Object, Rygel.StateMachine {
     protected abstract async void handle () throws Error;
 
     protected virtual async void find_item () throws Error {
-        // Fetch the requested item
-        var media_object = yield this.root_container.find_object
+        // Fetch the requested item, without walking the tree if it is
+        // an in-memory object
+        var media_object = ObjectIndex.get_default ().lookup
+                                        (this.uri.item_id,
+                                         this.root_container);
+        if (media_object == null) {
+            media_object = yield this.root_container.find_object
                                         (this.uri.item_id, null);
+        }
 
         if (media_object == null ||
             !((media_object is MediaContainer &&
@@ -127,6 +146,11 @@ public abstract class Rygel.HTTPRequest : GLib.Object, Rygel.StateMachine {
             this.msg.set_status (status, reason);
         }
 
+        if (this.trace != null) {
+            this.trace.finish ();
+            this.trace = null;
+        }
+
         this.completed ();
     }
 }
@@ -74,7 +74,11 @@ public class Rygel.HTTPResponse : GLib.Object, Rygel.StateMachine {
         this.seek = request.seek;
         this.speed = request.speed_request;
         this.src = src;
-        this.sink = new DataSink (this.src, this.server, this.msg, this.seek);
+        this.sink = new DataSink (this.src,
+                                  this.server,
+                                  this.msg,
+                                  this.seek,
+                                  request.trace);
         this.src.done.connect ( () => {
             this.end (false, Status.NONE);
         });
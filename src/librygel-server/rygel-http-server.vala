@@ -43,6 +43,8 @@ public class Rygel.HTTPServer : GLib.Object, Rygel.StateMachine {
     public Cancellable cancellable { get; set; }
 
     private const string SERVER_TEMPLATE = "%s/%s %s/%s DLNA/1.51 UPnP/1.0";
+    // Below path_root, only served if request metrics are enabled
+    private const string METRICS_PATH = "/metrics";
 
     public HTTPServer (ContentDirectory content_dir,
                        string           name) {
@@ -81,6 +83,11 @@ public class Rygel.HTTPServer : GLib.Object, Rygel.StateMachine {
 
     public async void run () {
         context.add_server_handler (true, this.path_root, this.server_handler);
+        if (RequestMetrics.get_default () != null) {
+            context.add_server_handler (false,
+                                        this.path_root + METRICS_PATH,
+                                        this.metrics_handler);
+        }
         context.server.request_aborted.connect (this.on_request_aborted);
         context.server.request_started.connect (this.on_request_started);
         context.server.request_read.connect (this.on_request_read);
@@ -113,6 +120,9 @@ public class Rygel.HTTPServer : GLib.Object, Rygel.StateMachine {
         this.cancellable.cancel ();
 
         context.server.remove_handler (this.path_root);
+        if (RequestMetrics.get_default () != null) {
+            context.server.remove_handler (this.path_root + METRICS_PATH);
+        }
 
         this.completed ();
     }
@@ -175,6 +185,36 @@ public class Rygel.HTTPServer : GLib.Object, Rygel.StateMachine {
         this.queue_request (new HTTPGet (this, server, msg));
     }
 
+    /**
+     * Serve the request metrics in the text exposition format, to clients on
+     * this host only.
+     */
+    private void metrics_handler (Soup.Server               server,
+                                  Soup.ServerMessage        msg,
+                                  string                    server_path,
+                                  HashTable<string,string>? query) {
+        var address = msg.get_remote_address () as InetSocketAddress;
+        if (address == null ||
+            !(address.get_address ().get_is_loopback () ||
+              address.get_address ().equal (this.context.get_address ()))) {
+            msg.set_status (Soup.Status.FORBIDDEN, null);
+
+            return;
+        }
+
+        if (msg.get_method () != "GET") {
+            msg.set_status (Soup.Status.METHOD_NOT_ALLOWED, null);
+
+            return;
+        }
+
+        var text = RequestMetrics.get_default ().to_text ();
+        msg.set_response ("text/plain; version=0.0.4; charset=utf-8",
+                          Soup.MemoryUse.COPY,
+                          text.data);
+        msg.set_status (Soup.Status.OK, null);
+    }
+
     private void on_request_aborted (Soup.Server        server,
                                      Soup.ServerMessage message) {
         foreach (var request in this.requests) {
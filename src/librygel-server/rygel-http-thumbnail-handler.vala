@@ -59,6 +59,29 @@ internal class Rygel.HTTPThumbnailHandler : Rygel.HTTPGetHandler {
         }
     }
 
+    /**
+     * Create the thumbnail file if it was not created yet.
+     */
+    public async void ensure_thumbnail () throws Error {
+        var thumbnailer = Thumbnailer.get_default ();
+        var uri = this.media_item.get_primary_uri ();
+        if (thumbnailer == null || uri == null) {
+            return;
+        }
+
+        try {
+            yield thumbnailer.ensure_thumbnail (this.thumbnail,
+                                                uri,
+                                                this.cancellable);
+        } catch (IOError.CANCELLED error) {
+            throw error;
+        } catch (Error error) {
+            throw new HTTPRequestError.NOT_FOUND
+                                        ("Failed to create thumbnail: %s",
+                                         error.message);
+        }
+    }
+
     public override bool supports_transfer_mode (string mode) {
         // Support interactive and background transfers only
         return (mode != TRANSFER_MODE_STREAMING);
@@ -96,6 +119,23 @@ internal class Rygel.HTTPThumbnailHandler : Rygel.HTTPGetHandler {
         }
     }
 
+    /**
+     * Get the thumbnail from memory, so it can be sent without a data
+     * source.
+     *
+     * @return the cached thumbnail or null if it is too large to be cached
+     */
+    public async ThumbnailCache.Entry? get_cached_body () {
+        if (this.thumbnail.size <= 0 ||
+            this.thumbnail.size > ThumbnailCache.MAX_ENTRY_SIZE) {
+            return null;
+        }
+
+        var cache = ThumbnailCache.get_default ();
+
+        return yield cache.lookup (this.thumbnail.uri, this.cancellable);
+    }
+
     public override int64 get_resource_size () {
         return thumbnail.size;
     }
@@ -37,17 +37,22 @@ internal abstract class Rygel.LastChangeEntry : Object {
 
     public string to_string () {
         var str = new StringBuilder ();
-        var info = this.additional_info ();
+        this.append_to (str);
+
+        return str.str;
+    }
 
-        str.append ("<" + this.tag + " " +
-                    "objID=\"" + this.id + "\" " +
-                    "updateID=\"" + this.update_id.to_string () + "\"");
+    public void append_to (StringBuilder str) {
+        str.append_printf ("<%s objID=\"%s\" updateID=\"%u\"",
+                           this.tag,
+                           this.id,
+                           this.update_id);
 
+        var info = this.additional_info ();
         if (info.length > 0) {
-            str.append (" " + info);
+            str.append_c (' ');
+            str.append (info);
         }
         str.append ("/>");
-
-        return str.str;
     }
 }
@@ -22,6 +22,9 @@ using GUPnP;
 using Gee;
 
 // Helper class for building ContentDirectory LastChange messages
+//
+// The message is kept complete at all times; each new entry is inserted
+// before the footer, so getting the log does not re-serialize all entries.
 internal class Rygel.LastChange : Object {
     private const string HEADER =
         "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" +
@@ -35,43 +38,32 @@ internal class Rygel.LastChange : Object {
 
     private const string FOOTER = "</StateEvent>";
 
-    private LinkedList<LastChangeEntry> entries;
     private StringBuilder str;
-    private bool update;
     private bool clear_on_add;
 
     public LastChange () {
-        this.entries = new LinkedList<LastChangeEntry> ();
-        this.str = new StringBuilder ();
-        this.update = true;
+        this.str = new StringBuilder (HEADER);
+        this.str.append (FOOTER);
         this.clear_on_add = false;
     }
 
     public void add_event (LastChangeEntry entry) {
         if (this.clear_on_add) {
             this.clear_on_add = false;
-            this.entries.clear ();
+            this.str.truncate (HEADER.length);
+        } else {
+            this.str.truncate ((size_t) this.str.len - FOOTER.length);
         }
-        this.entries.add (entry);
-        this.update = true;
+
+        entry.append_to (this.str);
+        this.str.append (FOOTER);
     }
 
     public void clear_on_new_event () {
         this.clear_on_add = true;
     }
 
-    public string get_log () {
-        if (this.update) {
-            this.str.erase ();
-
-            this.str.append (HEADER);
-            foreach (LastChangeEntry entry in this.entries) {
-                str.append (entry.to_string ());
-            }
-            this.str.append (FOOTER);
-            this.update = false;
-        }
-
+    public unowned string get_log () {
         return this.str.str;
     }
 }
@@ -54,46 +54,37 @@ public class Rygel.MediaArtStore : GLib.Object {
     }
 
     public Thumbnail? lookup_media_art (MusicItem item) throws Error {
-        File file = null;
-
-        foreach (var type in MediaArtStore.types) {
-            if (type == "album" && item.album == null && item.artist == null) {
-                continue;
-            } else if (item.artist == null && item.title == null) {
-                continue;
-            }
-
-            MediaArt.get_file (item.artist,
-                               type == "album" ? item.album : item.title,
-                               type,
-                               out file);
-
-            if (file != null && file.query_exists (null)) {
-                break;
-            } else {
-                file = null;
-            }
-        }
-
-        if (file == null) {
-            return null;
+        var cache = SidecarCache.get_default ();
+        var group = MediaArtStore.get_group (item);
+        var name = item.title ?? "";
+
+        var value = cache.lookup (group, name);
+        if (value == null) {
+            value = this.find_media_art (item);
+            cache.remember (group, name, value);
         }
 
-        var info = file.query_info (FileAttribute.ACCESS_CAN_READ + "," +
-                                    FileAttribute.STANDARD_SIZE,
-                                    FileQueryInfoFlags.NONE,
-                                    null);
-        if (!info.get_attribute_boolean (FileAttribute.ACCESS_CAN_READ)) {
+        // uri and size of the art, or nothing
+        var fields = value.split ("\t", 2);
+        if (fields.length != 2) {
             return null;
         }
 
         var thumb = new Thumbnail ();
-        thumb.uri = file.get_uri ();
-        thumb.size = (int64) info.get_size ();
+        thumb.uri = fields[0];
+        thumb.size = int64.parse (fields[1]);
 
         return thumb;
     }
 
+    /**
+     * Forget the cached art of @item, e.g. after it was extracted again.
+     */
+    public void forget (MusicItem item) {
+        var group = MediaArtStore.get_group (item);
+        SidecarCache.get_default ().invalidate (group);
+    }
+
     public void add (MusicItem item, File file, uint8[] data, string mime) {
         if (this.media_art_process == null) {
             return;
@@ -107,6 +98,7 @@ public class Rygel.MediaArtStore : GLib.Object {
                                            mime,
                                            item.artist,
                                            item.album);
+            this.forget (item);
         } catch (Error error) {
             warning (_("Failed to add album art for %s: %s"),
                      file.get_uri (),
@@ -121,6 +113,7 @@ public class Rygel.MediaArtStore : GLib.Object {
                                          file,
                                          item.artist,
                                          item.album);
+            this.forget (item);
         } catch (Error error) {
             warning (_("Failed to find media art for %s: %s"),
                      file.get_uri (),
@@ -128,6 +121,50 @@ public class Rygel.MediaArtStore : GLib.Object {
         }
     }
 
+    // All lookups of an artist and album share a group, as art added for
+    // the album may be found for every track
+    private static string get_group (MusicItem item) {
+        return "art:%s\n%s".printf (item.artist ?? "", item.album ?? "");
+    }
+
+    private string find_media_art (MusicItem item) throws Error {
+        File file = null;
+
+        foreach (var type in MediaArtStore.types) {
+            if (type == "album" && item.album == null && item.artist == null) {
+                continue;
+            } else if (item.artist == null && item.title == null) {
+                continue;
+            }
+
+            MediaArt.get_file (item.artist,
+                               type == "album" ? item.album : item.title,
+                               type,
+                               out file);
+
+            if (file != null && file.query_exists (null)) {
+                break;
+            } else {
+                file = null;
+            }
+        }
+
+        if (file == null) {
+            return "";
+        }
+
+        var info = file.query_info (FileAttribute.ACCESS_CAN_READ + "," +
+                                    FileAttribute.STANDARD_SIZE,
+                                    FileQueryInfoFlags.NONE,
+                                    null);
+        if (!info.get_attribute_boolean (FileAttribute.ACCESS_CAN_READ)) {
+            return "";
+        }
+
+        return "%s\t%s".printf (file.get_uri (),
+                                info.get_size ().to_string ());
+    }
+
     private MediaArtStore () throws MediaArtStoreError {
         try {
             this.media_art_process = new MediaArt.Process ();
@@ -206,6 +206,23 @@ public abstract class Rygel.MediaContainer : MediaObject {
      */
     public signal void sub_tree_updates_finished (MediaObject sub_tree_root);
 
+    /**
+     * The stream_started signal is emitted on the root container when the
+     * body of a resource is about to be sent to a client.
+     *
+     * @param object The object the resource belongs to.
+     */
+    public signal void stream_started (MediaObject object);
+
+    /**
+     * The stream_finished signal is emitted on the root container when a
+     * resource announced with #RygelMediaContainer::stream_started has been
+     * sent or the transfer was aborted.
+     *
+     * @param object The object the resource belongs to.
+     */
+    public signal void stream_finished (MediaObject object);
+
     public int child_count { get; set construct; }
     protected int empty_child_count { get; set; }
     public int all_child_count {
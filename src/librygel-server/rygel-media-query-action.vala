@@ -46,9 +46,11 @@ internal abstract class Rygel.MediaQueryAction : GLib.Object, StateMachine {
     protected HTTPServer http_server;
     protected uint32 system_update_id;
     protected ServiceAction action;
-    protected Serializer serializer;
+    protected DIDLFragmentCache didl_fragments;
     protected ClientHacks hacks;
     protected string object_id_arg;
+    // Only set if request metrics are enabled
+    protected RequestTrace? trace;
 
     protected MediaQueryAction (ContentDirectory    content_dir,
                                 owned ServiceAction action) {
@@ -58,19 +60,29 @@ internal abstract class Rygel.MediaQueryAction : GLib.Object, StateMachine {
         this.cancellable = content_dir.cancellable;
         this.action = (owned) action;
 
-        this.serializer = new Serializer (SerializerType.GENERIC_DIDL);
+        this.didl_fragments = content_dir.didl_fragments;
 
         try {
             this.hacks = ClientHacks.create (this.action.get_message ());
         } catch { /* This just means we need no hacks, yay! */ }
+
+        var metrics = RequestMetrics.get_default ();
+        if (metrics != null) {
+            this.trace = new RequestTrace (metrics,
+                                           this.action.get_name ().down (),
+                                           this.hacks);
+        }
     }
 
     public async void run () {
         try {
             this.parse_args ();
+            this.mark ("parse");
 
             var media_object = yield this.fetch_media_object ();
+            this.mark ("find-object");
             var results = yield this.fetch_results (media_object);
+            this.mark ("query");
 
             this.number_returned = results.size;
             if (media_object is MediaContainer) {
@@ -80,12 +92,15 @@ internal abstract class Rygel.MediaQueryAction : GLib.Object, StateMachine {
             }
 
 
-            results.serialize (this.serializer,
-                               this.http_server,
-                               this.hacks);
+            var didl = this.didl_fragments.serialize ((owned) results,
+                                                      this.http_server,
+                                                      this.hacks,
+                                                      this.filter,
+                                                      this.system_update_id);
+            this.mark ("serialize");
 
             // Conclude the successful Browse/Search action
-            this.conclude ();
+            this.conclude (didl);
         } catch (Error err) {
             this.handle_error (err);
         }
@@ -203,13 +218,7 @@ internal abstract class Rygel.MediaQueryAction : GLib.Object, StateMachine {
         }
     }
 
-    private void conclude () {
-        // Apply the filter from the client
-        this.serializer.filter (this.filter);
-
-        /* Retrieve generated string */
-        string didl = this.serializer.get_string ();
-
+    private void conclude (string didl) {
         if (this.update_id == uint32.MAX) {
             this.update_id = this.system_update_id;
         }
@@ -229,6 +238,7 @@ internal abstract class Rygel.MediaQueryAction : GLib.Object, StateMachine {
                              this.update_id);
 
         this.action.return_success ();
+        this.finish_trace ();
         this.completed ();
     }
 
@@ -239,6 +249,20 @@ internal abstract class Rygel.MediaQueryAction : GLib.Object, StateMachine {
             this.action.return_error (701, error.message);
         }
 
+        this.finish_trace ();
         this.completed ();
     }
+
+    protected void mark (string phase) {
+        if (this.trace != null) {
+            this.trace.mark (phase);
+        }
+    }
+
+    private void finish_trace () {
+        if (this.trace != null) {
+            this.trace.finish ();
+            this.trace = null;
+        }
+    }
 }
@@ -0,0 +1,147 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * Index of in-memory objects by id.
+ *
+ * SimpleContainer adds its children here, so they can be found without
+ * walking the tree. Ids are only unique within one server, so there may be
+ * several objects with the same id from different plugins; a lookup picks
+ * the one below the container it is done for.
+ *
+ * The index does not keep the objects alive. Containers remove their
+ * children when they drop them, and entries of objects that went away
+ * without being removed, e.g. because SimpleContainer.children was changed
+ * directly, are dropped whenever they come up.
+ */
+internal class Rygel.ObjectIndex : Object {
+    private class Entry {
+        public WeakRef object;
+        public Entry? next;
+    }
+
+    private static ObjectIndex instance;
+
+    private HashMap<string, Entry> entries;
+
+    private ObjectIndex () {
+        this.entries = new HashMap<string, Entry> ();
+    }
+
+    public static ObjectIndex get_default () {
+        if (ObjectIndex.instance == null) {
+            ObjectIndex.instance = new ObjectIndex ();
+        }
+
+        return ObjectIndex.instance;
+    }
+
+    public void add (MediaObject object) {
+        this.prune (object.id);
+
+        var first = this.entries[object.id];
+        for (var entry = first; entry != null; entry = entry.next) {
+            if (entry.object.get () == object) {
+                return;
+            }
+        }
+
+        var entry = new Entry ();
+        entry.object = WeakRef (object);
+        entry.next = first;
+        this.entries[object.id] = entry;
+    }
+
+    public void remove (MediaObject object) {
+        this.prune (object.id);
+
+        Entry previous = null;
+
+        for (var entry = this.entries[object.id];
+             entry != null;
+             entry = entry.next) {
+            if (entry.object.get () != object) {
+                previous = entry;
+
+                continue;
+            }
+
+            this.unlink (object.id, previous, entry);
+
+            return;
+        }
+    }
+
+    /**
+     * Find the object with @id below @root.
+     *
+     * @return the object, or null if it is not in the index
+     */
+    public MediaObject? lookup (string id, MediaContainer root) {
+        this.prune (id);
+
+        for (var entry = this.entries[id]; entry != null; entry = entry.next) {
+            var object = entry.object.get () as MediaObject;
+            if (object == null) {
+                continue;
+            }
+
+            for (unowned MediaObject ancestor = object;
+                 ancestor != null;
+                 ancestor = ancestor.parent) {
+                if (ancestor == root) {
+                    return object;
+                }
+            }
+        }
+
+        return null;
+    }
+
+    /**
+     * Drop the entries for @id whose object has been destroyed.
+     */
+    private void prune (string id) {
+        Entry previous = null;
+        var entry = this.entries[id];
+
+        while (entry != null) {
+            var next = entry.next;
+
+            if (entry.object.get () == null) {
+                this.unlink (id, previous, entry);
+            } else {
+                previous = entry;
+            }
+
+            entry = next;
+        }
+    }
+
+    private void unlink (string id, Entry? previous, Entry entry) {
+        if (previous != null) {
+            previous.next = entry.next;
+        } else if (entry.next != null) {
+            this.entries[id] = entry.next;
+        } else {
+            this.entries.unset (id);
+        }
+    }
+}
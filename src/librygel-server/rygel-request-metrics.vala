@@ -0,0 +1,386 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * Histograms of where the time of HTTP requests and ContentDirectory
+ * actions goes, by operation, phase and client.
+ *
+ * Collecting them is enabled with the request-metrics option. Without it,
+ * get_default () returns null and requests carry no RequestTrace, so the
+ * only cost is a null check per phase.
+ *
+ * The histograms are available through Rygel.Statistics and, for clients on
+ * the same host, in the text exposition format on the metrics path of each
+ * HTTPServer.
+ */
+internal class Rygel.RequestMetrics : Object, StatisticsProvider {
+    // Bucket bounds grow by a factor of four, from 16 µs to about 17 s for
+    // durations and from 1 KiB/s to 1 GiB/s for throughput
+    private const int BUCKETS = 11;
+    private const int64 FIRST_DURATION_BOUND = 16;
+    private const int64 FIRST_THROUGHPUT_BOUND = 1024;
+
+    private class Histogram {
+        public int64 first_bound;
+        public uint64 count;
+        public int64 sum;
+        public int64 max;
+        // The last bucket takes everything above the largest bound
+        public uint64[] buckets = new uint64[BUCKETS + 1];
+
+        public Histogram (int64 first_bound) {
+            this.first_bound = first_bound;
+        }
+
+        public int64 get_bound (int bucket) {
+            return this.first_bound << (2 * bucket);
+        }
+
+        public void add (int64 value) {
+            this.count++;
+            this.sum += value;
+            this.max = int64.max (this.max, value);
+
+            var bucket = 0;
+            while (bucket < BUCKETS && value > this.get_bound (bucket)) {
+                bucket++;
+            }
+            this.buckets[bucket]++;
+        }
+
+        /**
+         * Get an upper bound of the value below which @fraction of the
+         * samples are.
+         */
+        public int64 percentile (double fraction) {
+            var wanted = (uint64) (this.count * fraction);
+            if (wanted < this.count * fraction) {
+                wanted++;
+            }
+            uint64 seen = 0;
+
+            for (var i = 0; i < BUCKETS; i++) {
+                seen += this.buckets[i];
+                if (seen >= wanted) {
+                    return int64.min (this.get_bound (i), this.max);
+                }
+            }
+
+            return this.max;
+        }
+    }
+
+    private static RequestMetrics instance;
+    private static bool configured;
+
+    // Keyed by operation, phase and client, separated by newlines
+    private HashMap<string, Histogram> durations;
+    private HashMap<string, Histogram> throughputs;
+
+    /**
+     * Get the metrics, if they are enabled.
+     *
+     * @return the metrics or null if request-metrics is not set
+     */
+    public static RequestMetrics? get_default () {
+        if (RequestMetrics.configured) {
+            return RequestMetrics.instance;
+        }
+
+        RequestMetrics.configured = true;
+        try {
+            var config = MetaConfig.get_default ();
+            if (config.get_bool ("general", "request-metrics")) {
+                RequestMetrics.instance = new RequestMetrics ();
+                Statistics.get_default ().register ("requests",
+                                                    RequestMetrics.instance);
+            }
+        } catch (Error error) { }
+
+        return RequestMetrics.instance;
+    }
+
+    /**
+     * Get the name of the class of client for @hacks, such as "Samsung".
+     */
+    public static string get_client_class (ClientHacks? hacks) {
+        if (hacks == null) {
+            return "generic";
+        }
+
+        var name = hacks.get_type ().name ();
+        if (name.has_prefix ("Rygel")) {
+            name = name.substring (5);
+        }
+
+        if (name.has_suffix ("Hacks")) {
+            name = name.substring (0, name.length - 5);
+        }
+
+        return name;
+    }
+
+    private RequestMetrics () {
+        this.durations = new HashMap<string, Histogram> ();
+        this.throughputs = new HashMap<string, Histogram> ();
+    }
+
+    /**
+     * Account the time spent in a phase of a request.
+     *
+     * @param time the duration in microseconds
+     */
+    public void add_duration (string operation,
+                              string phase,
+                              string client,
+                              int64  time) {
+        var key = string.join ("\n", operation, phase, client);
+        var histogram = this.durations[key];
+        if (histogram == null) {
+            histogram = new Histogram (FIRST_DURATION_BOUND);
+            this.durations[key] = histogram;
+        }
+
+        histogram.add (time);
+    }
+
+    /**
+     * Account the rate at which the body of a response was sent.
+     *
+     * @param rate the throughput in bytes per second
+     */
+    public void add_throughput (string operation, string client, int64 rate) {
+        var key = string.join ("\n", operation, "body", client);
+        var histogram = this.throughputs[key];
+        if (histogram == null) {
+            histogram = new Histogram (FIRST_THROUGHPUT_BOUND);
+            this.throughputs[key] = histogram;
+        }
+
+        histogram.add (rate);
+    }
+
+    /**
+     * Get the statistics of all histograms.
+     *
+     * @return a dictionary of type a{sa{sv}}, keyed by
+     * "operation/phase/client", with count, total, p50, p90, p99 and max.
+     * Durations are given in microseconds, throughput in bytes per second.
+     */
+    public Variant get_statistics () {
+        var builder = new VariantBuilder (new VariantType ("a{sa{sv}}"));
+
+        this.add_statistics (builder, this.durations, "-us");
+        this.add_statistics (builder, this.throughputs, "-bps");
+
+        return builder.end ();
+    }
+
+    /**
+     * Write all histograms in the Prometheus text exposition format.
+     */
+    public string to_text () {
+        var builder = new StringBuilder ();
+
+        builder.append ("# HELP rygel_request_phase_seconds " +
+                        "Time spent in each phase of a request.\n");
+        builder.append ("# TYPE rygel_request_phase_seconds histogram\n");
+        this.append_text (builder,
+                          "rygel_request_phase_seconds",
+                          this.durations,
+                          1000000.0);
+
+        builder.append ("# HELP rygel_response_throughput_bytes_per_second " +
+                        "Rate at which response bodies were sent.\n");
+        builder.append ("# TYPE rygel_response_throughput_bytes_per_second " +
+                        "histogram\n");
+        this.append_text (builder,
+                          "rygel_response_throughput_bytes_per_second",
+                          this.throughputs,
+                          1.0);
+
+        return builder.str;
+    }
+
+    private void add_statistics (VariantBuilder                builder,
+                                 HashMap<string, Histogram>    histograms,
+                                 string                        unit) {
+        foreach (var entry in histograms) {
+            var value = entry.value;
+            var details = new VariantBuilder (new VariantType ("a{sv}"));
+            details.add ("{sv}", "count", new Variant.uint64 (value.count));
+            details.add ("{sv}",
+                         "total" + unit,
+                         new Variant.int64 (value.sum));
+            details.add ("{sv}",
+                         "p50" + unit,
+                         new Variant.int64 (value.percentile (0.5)));
+            details.add ("{sv}",
+                         "p90" + unit,
+                         new Variant.int64 (value.percentile (0.9)));
+            details.add ("{sv}",
+                         "p99" + unit,
+                         new Variant.int64 (value.percentile (0.99)));
+            details.add ("{sv}",
+                         "max" + unit,
+                         new Variant.int64 (value.max));
+            builder.add ("{sa{sv}}",
+                         entry.key.replace ("\n", "/"),
+                         details);
+        }
+    }
+
+    private void append_text (StringBuilder              builder,
+                              string                     name,
+                              HashMap<string, Histogram> histograms,
+                              double                     scale) {
+        foreach (var entry in histograms) {
+            var parts = entry.key.split ("\n");
+            var labels = "operation=\"%s\",phase=\"%s\",client=\"%s\"".printf
+                                        (parts[0], parts[1], parts[2]);
+            var histogram = entry.value;
+
+            uint64 cumulative = 0;
+            for (var i = 0; i < BUCKETS; i++) {
+                cumulative += histogram.buckets[i];
+                var bound = histogram.get_bound (i) / scale;
+                builder.append_printf ("%s_bucket{%s,le=\"%s\"} %s\n",
+                                       name,
+                                       labels,
+                                       bound.to_string (),
+                                       cumulative.to_string ());
+            }
+            builder.append_printf ("%s_bucket{%s,le=\"+Inf\"} %s\n",
+                                   name,
+                                   labels,
+                                   histogram.count.to_string ());
+            builder.append_printf ("%s_sum{%s} %s\n",
+                                   name,
+                                   labels,
+                                   (histogram.sum / scale).to_string ());
+            builder.append_printf ("%s_count{%s} %s\n",
+                                   name,
+                                   labels,
+                                   histogram.count.to_string ());
+        }
+    }
+}
+
+/**
+ * Timing of a single request, accounted in RequestMetrics.
+ *
+ * Each call to mark () accounts the time since the previous one, so a
+ * request marks the end of each of its phases in order.
+ */
+internal class Rygel.RequestTrace {
+    private RequestMetrics metrics;
+    private string operation;
+    private string client;
+
+    private int64 start;
+    private int64 last;
+    private int64 first_byte;
+    private int64 frozen_since;
+    private int64 stalled;
+    private int64 bytes;
+
+    public RequestTrace (RequestMetrics metrics,
+                         string         operation,
+                         ClientHacks?   hacks) {
+        this.metrics = metrics;
+        this.operation = operation;
+        this.client = RequestMetrics.get_client_class (hacks);
+        this.start = get_monotonic_time ();
+        this.last = this.start;
+    }
+
+    /**
+     * Account the time since the previous phase ended as @phase.
+     */
+    public void mark (string phase) {
+        var now = get_monotonic_time ();
+        this.metrics.add_duration (this.operation,
+                                   phase,
+                                   this.client,
+                                   now - this.last);
+        this.last = now;
+    }
+
+    /**
+     * Note that @count bytes of the body were handed to the server.
+     */
+    public void sent (int64 count) {
+        if (this.first_byte == 0) {
+            this.first_byte = get_monotonic_time ();
+        }
+
+        this.bytes += count;
+    }
+
+    /**
+     * Note that the data source was told to stop producing data, because
+     * the client does not read fast enough.
+     */
+    public void freeze () {
+        if (this.frozen_since == 0) {
+            this.frozen_since = get_monotonic_time ();
+        }
+    }
+
+    public void thaw () {
+        if (this.frozen_since != 0) {
+            this.stalled += get_monotonic_time () - this.frozen_since;
+            this.frozen_since = 0;
+        }
+    }
+
+    /**
+     * Account the total time of the request and of its body.
+     */
+    public void finish () {
+        this.thaw ();
+
+        var now = get_monotonic_time ();
+        this.metrics.add_duration (this.operation,
+                                   "total",
+                                   this.client,
+                                   now - this.start);
+
+        if (this.first_byte == 0) {
+            return;
+        }
+
+        this.metrics.add_duration (this.operation,
+                                   "first-byte",
+                                   this.client,
+                                   this.first_byte - this.start);
+        this.metrics.add_duration (this.operation,
+                                   "stalled",
+                                   this.client,
+                                   this.stalled);
+
+        var time = now - this.first_byte;
+        if (time > 0) {
+            this.metrics.add_throughput (this.operation,
+                                         this.client,
+                                         this.bytes * TimeSpan.SECOND / time);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Recently parsed search criteria.
+ *
+ * Control points page through search results, sending the same criteria
+ * string with every request, so the parsed expression is kept. The
+ * expressions are shared by all searches using them and must not be
+ * modified.
+ */
+internal class Rygel.SearchCriteriaCache : Object {
+    private const int MAX_ENTRIES = 32;
+
+    private class Entry {
+        public SearchExpression? expression;
+    }
+
+    private LruCache<string, Entry> entries;
+
+    public SearchCriteriaCache () {
+        this.entries = new LruCache<string, Entry> (MAX_ENTRIES);
+    }
+
+    /**
+     * Get the expression for @criteria, parsing it if it is not known yet.
+     *
+     * @return the expression, or null for the wildcard criteria
+     */
+    public async SearchExpression? parse (string criteria) throws Error {
+        var entry = this.entries[criteria];
+        if (entry != null) {
+            return entry.expression;
+        }
+
+        var parser = new SearchCriteriaParser (criteria);
+        yield parser.run ();
+
+        if (parser.err != null) {
+            throw new ContentDirectoryError.INVALID_SEARCH_CRITERIA
+                                        (_("Invalid search criteria given"));
+        }
+
+        // Another search for the same criteria may have finished first
+        entry = this.entries[criteria];
+        if (entry != null) {
+            return entry.expression;
+        }
+
+        entry = new Entry ();
+        entry.expression = parser.expression;
+        this.entries[criteria] = entry;
+
+        return entry.expression;
+    }
+}
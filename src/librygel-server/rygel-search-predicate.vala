@@ -0,0 +1,375 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using GUPnP;
+
+/**
+ * A search expression compiled for testing many objects against it.
+ *
+ * The expression tree is flattened into a postfix program. The operands
+ * are converted once, where RelationalExpression.satisfied_by () upper-cases
+ * and parses them for every object. The result is the same as that of
+ * satisfied_by ().
+ */
+internal class Rygel.SearchPredicate {
+    private enum Opcode {
+        TEST,
+        AND,
+        OR,
+        FALSE,
+        // Expressions that cannot be compiled, use satisfied_by ()
+        EXPRESSION
+    }
+
+    private enum Field {
+        UNKNOWN,
+        ID,
+        REF_ID,
+        PARENT_ID,
+        CLASS,
+        TITLE,
+        OBJECT_UPDATE_ID,
+        CONTAINER_UPDATE_ID,
+        CREATE_CLASS,
+        CREATOR,
+        ARTIST,
+        ALBUM,
+        CHILD_COUNT
+    }
+
+    private class Instruction {
+        public Opcode opcode;
+        public Field field;
+        public SearchCriteriaOp op;
+        // Upper-cased string operand
+        public string text;
+        public int int_operand;
+        public uint64 uint_operand;
+        // For EXISTS, whether the operand is "true"
+        public bool exists;
+        public SearchExpression expression;
+    }
+
+    // The searches of a tree of containers all use the same expression, so
+    // keep the last one
+    private static SearchExpression last_expression;
+    private static SearchPredicate last_predicate;
+
+    private Instruction[] program;
+    private bool[] stack;
+
+    /**
+     * Get the compiled form of @expression.
+     */
+    public static SearchPredicate compile (SearchExpression expression) {
+        if (expression != SearchPredicate.last_expression) {
+            SearchPredicate.last_predicate = new SearchPredicate (expression);
+            SearchPredicate.last_expression = expression;
+        }
+
+        return SearchPredicate.last_predicate;
+    }
+
+    private SearchPredicate (SearchExpression expression) {
+        this.program = {};
+        this.add_expression (expression);
+        this.stack = new bool[this.program.length];
+    }
+
+    public bool matches (MediaObject media_object) {
+        var top = 0;
+
+        foreach (unowned Instruction instruction in this.program) {
+            switch (instruction.opcode) {
+            case Opcode.AND:
+                top--;
+                this.stack[top - 1] = this.stack[top - 1] && this.stack[top];
+                break;
+            case Opcode.OR:
+                top--;
+                this.stack[top - 1] = this.stack[top - 1] || this.stack[top];
+                break;
+            case Opcode.FALSE:
+                this.stack[top++] = false;
+                break;
+            case Opcode.EXPRESSION:
+                this.stack[top++] = instruction.expression.satisfied_by
+                                        (media_object);
+                break;
+            default:
+                this.stack[top++] = SearchPredicate.test (instruction,
+                                                          media_object);
+                break;
+            }
+        }
+
+        return top > 0 && this.stack[0];
+    }
+
+    private void add_expression (SearchExpression expression) {
+        var instruction = new Instruction ();
+
+        if (expression is LogicalExpression) {
+            var logical = expression as LogicalExpression;
+            switch (logical.op) {
+            case LogicalOperator.AND:
+                instruction.opcode = Opcode.AND;
+                break;
+            case LogicalOperator.OR:
+                instruction.opcode = Opcode.OR;
+                break;
+            default:
+                instruction.opcode = Opcode.FALSE;
+                this.program += instruction;
+
+                return;
+            }
+
+            this.add_expression (logical.operand1);
+            this.add_expression (logical.operand2);
+            this.program += instruction;
+
+            return;
+        }
+
+        var relational = expression as RelationalExpression;
+        if (relational == null) {
+            instruction.opcode = Opcode.EXPRESSION;
+            instruction.expression = expression;
+            this.program += instruction;
+
+            return;
+        }
+
+        instruction.opcode = Opcode.TEST;
+        instruction.field = SearchPredicate.map_field (relational.operand1);
+        instruction.op = relational.op;
+        instruction.text = relational.operand2.up ();
+        instruction.int_operand = int.parse (relational.operand2);
+        instruction.uint_operand = uint64.parse (relational.operand2);
+        instruction.exists = relational.operand2 == "true";
+        this.program += instruction;
+    }
+
+    private static Field map_field (string property) {
+        switch (property) {
+        case "@id":
+            return Field.ID;
+        case "@refID":
+            return Field.REF_ID;
+        case "@parentID":
+            return Field.PARENT_ID;
+        case "upnp:class":
+            return Field.CLASS;
+        case "dc:title":
+            return Field.TITLE;
+        case "upnp:objectUpdateID":
+            return Field.OBJECT_UPDATE_ID;
+        case "upnp:containerUpdateID":
+            return Field.CONTAINER_UPDATE_ID;
+        case "upnp:createClass":
+            return Field.CREATE_CLASS;
+        case "dc:creator":
+            return Field.CREATOR;
+        case "upnp:artist":
+            return Field.ARTIST;
+        case "upnp:album":
+            return Field.ALBUM;
+        case "@childCount":
+            return Field.CHILD_COUNT;
+        default:
+            return Field.UNKNOWN;
+        }
+    }
+
+    private static bool test (Instruction instruction,
+                              MediaObject media_object) {
+        switch (instruction.field) {
+        case Field.ID:
+            return SearchPredicate.compare_string (instruction,
+                                                   media_object.id);
+        case Field.REF_ID:
+            return SearchPredicate.compare_string (instruction,
+                                                   media_object.ref_id);
+        case Field.PARENT_ID:
+            var parent = media_object.parent;
+
+            return SearchPredicate.compare_string
+                                        (instruction,
+                                         parent != null ? parent.id : null);
+        case Field.CLASS:
+            return SearchPredicate.compare_class (instruction,
+                                                  media_object.upnp_class);
+        case Field.TITLE:
+            return SearchPredicate.compare_string (instruction,
+                                                   media_object.title);
+        case Field.OBJECT_UPDATE_ID:
+            if (instruction.op == SearchCriteriaOp.EXISTS) {
+                var trackable = media_object is TrackableContainer ||
+                                media_object is TrackableItem;
+
+                return trackable == instruction.exists;
+            }
+
+            return SearchPredicate.compare_uint
+                                        (instruction,
+                                         media_object.object_update_id);
+        case Field.CONTAINER_UPDATE_ID:
+            var container = media_object as MediaContainer;
+            if (container == null) {
+                return false;
+            }
+
+            if (instruction.op == SearchCriteriaOp.EXISTS) {
+                return (container is TrackableContainer) ==
+                       instruction.exists;
+            }
+
+            return SearchPredicate.compare_uint (instruction,
+                                                 container.update_id);
+        case Field.CREATE_CLASS:
+            var writable = media_object as WritableContainer;
+            if (writable == null) {
+                return false;
+            }
+
+            foreach (var create_class in writable.create_classes) {
+                if (SearchPredicate.compare_class (instruction,
+                                                   create_class)) {
+                    return true;
+                }
+            }
+
+            return false;
+        case Field.CREATOR:
+            var item = media_object as PhotoItem;
+
+            return item != null &&
+                   SearchPredicate.compare_string (instruction, item.creator);
+        case Field.ARTIST:
+            var item = media_object as MusicItem;
+
+            return item != null &&
+                   SearchPredicate.compare_string (instruction, item.artist);
+        case Field.ALBUM:
+            var item = media_object as MusicItem;
+
+            return item != null &&
+                   SearchPredicate.compare_string (instruction, item.album);
+        case Field.CHILD_COUNT:
+            var container = media_object as MediaContainer;
+
+            return container != null &&
+                   SearchPredicate.compare_int (instruction,
+                                                container.child_count);
+        default:
+            return false;
+        }
+    }
+
+    private static bool compare_string (Instruction instruction,
+                                        string?     str) {
+        if (instruction.op == SearchCriteriaOp.EXISTS) {
+            return (str != null) == instruction.exists;
+        }
+
+        if (str == null) {
+            return instruction.op == SearchCriteriaOp.NEQ;
+        }
+
+        var up_str = str.up ();
+
+        switch (instruction.op) {
+        case SearchCriteriaOp.EQ:
+            return up_str == instruction.text;
+        case SearchCriteriaOp.NEQ:
+            return up_str != instruction.text;
+        case SearchCriteriaOp.CONTAINS:
+            return up_str.contains (instruction.text);
+        case SearchCriteriaOp.DERIVED_FROM:
+            return up_str.has_prefix (instruction.text);
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Like compare_string (), but without copying @upnp_class, as UPnP
+     * classes are plain ASCII.
+     */
+    private static bool compare_class (Instruction instruction,
+                                       string?     upnp_class) {
+        if (upnp_class == null) {
+            return SearchPredicate.compare_string (instruction, null);
+        }
+
+        switch (instruction.op) {
+        case SearchCriteriaOp.EQ:
+            return upnp_class.ascii_casecmp (instruction.text) == 0;
+        case SearchCriteriaOp.NEQ:
+            return upnp_class.ascii_casecmp (instruction.text) != 0;
+        case SearchCriteriaOp.DERIVED_FROM:
+            return upnp_class.ascii_ncasecmp (instruction.text,
+                                              instruction.text.length) == 0;
+        default:
+            return SearchPredicate.compare_string (instruction, upnp_class);
+        }
+    }
+
+    private static bool compare_int (Instruction instruction, int integer) {
+        var operand = instruction.int_operand;
+
+        switch (instruction.op) {
+        case SearchCriteriaOp.EQ:
+            return integer == operand;
+        case SearchCriteriaOp.NEQ:
+            return integer != operand;
+        case SearchCriteriaOp.LESS:
+            return integer < operand;
+        case SearchCriteriaOp.LEQ:
+            return integer <= operand;
+        case SearchCriteriaOp.GREATER:
+            return integer > operand;
+        case SearchCriteriaOp.GEQ:
+            return integer >= operand;
+        default:
+            return false;
+        }
+    }
+
+    private static bool compare_uint (Instruction instruction, uint integer) {
+        var operand = instruction.uint_operand;
+
+        switch (instruction.op) {
+        case SearchCriteriaOp.EQ:
+            return integer == operand;
+        case SearchCriteriaOp.NEQ:
+            return integer != operand;
+        case SearchCriteriaOp.LESS:
+            return integer < operand;
+        case SearchCriteriaOp.LEQ:
+            return integer <= operand;
+        case SearchCriteriaOp.GREATER:
+            return integer > operand;
+        case SearchCriteriaOp.GEQ:
+            return integer >= operand;
+        default:
+            return false;
+        }
+    }
+}
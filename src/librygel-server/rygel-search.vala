@@ -32,11 +32,14 @@ internal class Rygel.Search:  Rygel.MediaQueryAction {
     // In arguments
     public string search_criteria;
 
+    private SearchCriteriaCache criteria_cache;
+
     public Search (ContentDirectory    content_dir,
                    owned ServiceAction action) {
         base (content_dir, action);
 
         this.object_id_arg = "ContainerID";
+        this.criteria_cache = content_dir.search_criteria;
     }
 
     protected override void parse_args () throws Error {
@@ -62,26 +65,22 @@ internal class Rygel.Search:  Rygel.MediaQueryAction {
         }
 
         var container = media_object as SearchableContainer;
-        var parser = new Rygel.SearchCriteriaParser (this.search_criteria);
-        yield parser.run ();
-
-        if (parser.err != null) {
-            throw new ContentDirectoryError.INVALID_SEARCH_CRITERIA
-                                        (_("Invalid search criteria given"));
-        }
+        var expression = yield this.criteria_cache.parse
+                                        (this.search_criteria);
+        this.mark ("parse-criteria");
 
         var sort_criteria = this.sort_criteria ?? container.sort_criteria;
 
         if (this.hacks != null) {
             return yield this.hacks.search (container,
-                                            parser.expression,
+                                            expression,
                                             this.index,
                                             this.requested_count,
                                             sort_criteria,
                                             this.cancellable,
                                             out this.total_matches);
         } else {
-            return yield container.search (parser.expression,
+            return yield container.search (expression,
                                            this.index,
                                            this.requested_count,
                                            sort_criteria,
@@ -70,9 +70,9 @@ public interface Rygel.SearchableContainer : MediaContainer {
      * @param offset zero-based index of the first object to return
      * @param max_count maximum number of objects to return
      * @param total_matches sets it to the actual number of objects that satisfy
-     *                      the given search expression. If it is not possible
-     *                      to compute this value (in a timely mannger), it is
-     *                      set to '0'.
+     *                      the given search expression. If the search stopped
+     *                      after offset + max_count matches, it is not known
+     *                      and set to '0'.
      * @param cancellable optional cancellable for this operation
      *
      * @return A list of media objects.
@@ -107,9 +107,12 @@ public interface Rygel.SearchableContainer : MediaContainer {
             limit = 0; // No limits on searches
         }
 
+        var predicate = expression != null ?
+                        SearchPredicate.compile (expression) : null;
+
         // First add relavant children
         foreach (var child in children) {
-            if (expression == null || expression.satisfied_by (child)) {
+            if (predicate == null || predicate.matches (child)) {
                 result.add (child);
             }
 
@@ -129,9 +132,10 @@ public interface Rygel.SearchableContainer : MediaContainer {
             result.add_all (child_results);
         }
 
-        // Since we limited our search, we don't know how many objects
-        // actually satisfy the give search expression
-        if (max_count > 0) {
+        // If the search stopped at the limit, we don't know how many objects
+        // actually satisfy the given search expression. Otherwise everything
+        // has been looked at.
+        if (limit > 0 && result.size >= limit) {
             total_matches = 0;
         } else {
             total_matches = result.size;
@@ -170,6 +174,12 @@ public interface Rygel.SearchableContainer : MediaContainer {
     public async MediaObject? find_object (string       id,
                                            Cancellable? cancellable)
                                            throws Error {
+        var indexed = ObjectIndex.get_default ().lookup
+                                        (id, this as MediaContainer);
+        if (indexed != null) {
+            return indexed;
+        }
+
         var expression = new RelationalExpression ();
         expression.op = SearchCriteriaOp.EQ;
         expression.operand1 = "@id";
@@ -196,6 +206,13 @@ public interface Rygel.SearchableContainer : MediaContainer {
                                          string            sort_criteria,
                                          Cancellable?      cancellable)
                                         throws Error {
+        if (limit == 0) {
+            return yield this.search_in_children_concurrently (expression,
+                                                               children,
+                                                               sort_criteria,
+                                                               cancellable);
+        }
+
         var result = new MediaObjects ();
 
         foreach (var child in children) {
@@ -203,9 +220,10 @@ public interface Rygel.SearchableContainer : MediaContainer {
                 var container = child as SearchableContainer;
                 uint tmp;
 
+                // Only ask for what is still missing
                 var child_result = yield container.search (expression,
                                                            0,
-                                                           limit,
+                                                           limit - result.size,
                                                            sort_criteria,
                                                            cancellable,
                                                            out tmp);
@@ -213,7 +231,7 @@ public interface Rygel.SearchableContainer : MediaContainer {
                 result.add_all (child_result);
             }
 
-            if (limit > 0 && result.size >= limit) {
+            if (result.size >= limit) {
                 break;
             }
         }
@@ -221,6 +239,70 @@ public interface Rygel.SearchableContainer : MediaContainer {
         return result;
     }
 
+    /**
+     * Search all child containers at the same time.
+     *
+     * Without a limit every child has to be searched anyway, so there is no
+     * point in waiting for one before starting the next. The results are
+     * still returned in the order of @children.
+     */
+    private async MediaObjects search_in_children_concurrently
+                                        (SearchExpression? expression,
+                                         MediaObjects      children,
+                                         string            sort_criteria,
+                                         Cancellable?      cancellable)
+                                        throws Error {
+        var results = new MediaObjects?[children.size];
+        Error? error = null;
+        var pending = 1;
+
+        for (var i = 0; i < children.size; i++) {
+            var container = children[i] as SearchableContainer;
+            if (container == null) {
+                continue;
+            }
+
+            var index = i;
+            pending++;
+            container.search.begin (expression,
+                                    0,
+                                    0,
+                                    sort_criteria,
+                                    cancellable,
+                                    (obj, res) => {
+                try {
+                    uint tmp;
+                    results[index] = container.search.end (res, out tmp);
+                } catch (Error search_error) {
+                    if (error == null) {
+                        error = search_error;
+                    }
+                }
+
+                if (--pending == 0) {
+                    this.search_in_children_concurrently.callback ();
+                }
+            });
+        }
+
+        if (--pending > 0) {
+            yield;
+        }
+
+        if (error != null) {
+            throw error.copy ();
+        }
+
+        var result = new MediaObjects ();
+        foreach (var child_result in results) {
+            if (child_result != null) {
+                result.add_all (child_result);
+            }
+        }
+
+        return result;
+    }
+
     internal void serialize_search_parameters
                                         (DIDLLiteContainer didl_container) {
         foreach (var search_class in this.search_classes) {
@@ -0,0 +1,261 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * A lookup result to be written to a SidecarStore.
+ */
+public struct Rygel.SidecarRecord {
+    public string group;
+    public string name;
+    public string value;
+}
+
+/**
+ * Persistent backend of the SidecarCache.
+ *
+ * Plugins with a database of their own, such as MediaExport, implement this
+ * so the lookups survive a restart.
+ */
+public interface Rygel.SidecarStore : Object {
+    /**
+     * Get a stored lookup result.
+     *
+     * @return the value or null if nothing was stored for @group and @name
+     */
+    public abstract string? lookup (string group, string name) throws Error;
+
+    /**
+     * Store several lookup results at once, replacing existing ones.
+     */
+    public abstract void save (SidecarRecord[] records) throws Error;
+
+    /**
+     * Remove all lookup results of several groups at once.
+     */
+    public abstract void invalidate (string[] groups) throws Error;
+}
+
+/**
+ * Cache of the files found next to media files, such as album art and
+ * subtitles.
+ *
+ * Looking for these files costs several stat calls per item, and items are
+ * created for every Browse and Search result. The results of the lookups are
+ * kept here instead, including the negative ones, which are by far the most
+ * common.
+ *
+ * Results are organized in groups; all results of a group are invalidated at
+ * once when one of the files they depend on changes. A value is an opaque
+ * string defined by the caller, where the empty string means that nothing
+ * was found.
+ *
+ * Only results that found something are persisted. Files may be added while
+ * Rygel is not running or not watching, so a negative result is only kept
+ * until the next restart.
+ */
+public class Rygel.SidecarCache : Object {
+    // The groups are dropped all at once beyond this; the store still has
+    // them
+    private const int MAX_GROUPS = 8192;
+
+    private static SidecarCache instance;
+
+    private HashMap<string, HashMap<string, string>> groups;
+    private ArrayList<SidecarRecord?> pending;
+    private HashSet<string> invalidated;
+    private uint flush_id;
+
+    /**
+     * Where lookups are persisted, or null to keep them in memory only.
+     */
+    public SidecarStore? store { get; set; }
+
+    public static SidecarCache get_default () {
+        if (SidecarCache.instance == null) {
+            SidecarCache.instance = new SidecarCache ();
+        }
+
+        return SidecarCache.instance;
+    }
+
+    private SidecarCache () {
+        this.groups = new HashMap<string, HashMap<string, string>> ();
+        this.pending = new ArrayList<SidecarRecord?> ();
+        this.invalidated = new HashSet<string> ();
+    }
+
+    /**
+     * Get the cached result of a lookup.
+     *
+     * @return the value as passed to remember (), or null if the lookup
+     * needs to be done
+     */
+    public string? lookup (string group, string name) {
+        var names = this.groups[group];
+        if (names != null && names.has_key (name)) {
+            return names[name];
+        }
+
+        // The stored results are about to be removed
+        if (this.store == null || group in this.invalidated) {
+            return null;
+        }
+
+        try {
+            var value = this.store.lookup (group, name);
+
+            // Negative results of older versions are not trusted either
+            if (value == null || value == "") {
+                return null;
+            }
+
+            this.put (group, name, value);
+
+            return value;
+        } catch (Error error) {
+            debug ("Failed to look up %s in sidecar store: %s",
+                   group,
+                   error.message);
+
+            return null;
+        }
+    }
+
+    /**
+     * Remember the result of a lookup.
+     *
+     * A result that found something is written to the store from an idle
+     * handler, together with the others of the same main loop iteration.
+     */
+    public void remember (string group, string name, string value) {
+        this.put (group, name, value);
+
+        if (this.store == null || value == "") {
+            return;
+        }
+
+        SidecarRecord record = { group, name, value };
+        this.pending.add (record);
+        this.schedule_flush ();
+    }
+
+    /**
+     * Forget all results of @group.
+     *
+     * The results are removed from the store from an idle handler, like
+     * new results are written.
+     */
+    public void invalidate (string group) {
+        this.groups.unset (group);
+
+        var i = 0;
+        while (i < this.pending.size) {
+            if (this.pending[i].group == group) {
+                this.pending.remove_at (i);
+            } else {
+                i++;
+            }
+        }
+
+        if (this.store == null) {
+            return;
+        }
+
+        this.invalidated.add (group);
+        this.schedule_flush ();
+    }
+
+    /**
+     * Forget the results depending on @file, after it was created, changed
+     * or deleted.
+     */
+    public void file_changed (File file) {
+        if (!SubtitleManager.is_subtitle (file)) {
+            return;
+        }
+
+        var parent = file.get_parent ();
+        if (parent == null) {
+            return;
+        }
+
+        this.invalidate (SubtitleManager.get_group (parent, file));
+    }
+
+    private void put (string group, string name, string value) {
+        var names = this.groups[group];
+        if (names == null) {
+            if (this.groups.size >= MAX_GROUPS) {
+                this.groups.clear ();
+            }
+
+            names = new HashMap<string, string> ();
+            this.groups[group] = names;
+        }
+
+        names[name] = value;
+    }
+
+    private void schedule_flush () {
+        if (this.flush_id == 0) {
+            this.flush_id = Idle.add (this.flush, Priority.LOW);
+        }
+    }
+
+    private bool flush () {
+        this.flush_id = 0;
+
+        var groups = this.invalidated.to_array ();
+        this.invalidated.clear ();
+
+        // Results remembered after the invalidation of their group are
+        // still pending, so they are saved after it
+        if (this.store != null && groups.length > 0) {
+            try {
+                this.store.invalidate (groups);
+            } catch (Error error) {
+                warning (_("Failed to invalidate %d groups in sidecar " +
+                           "store: %s"),
+                         groups.length,
+                         error.message);
+            }
+        }
+
+        var records = new SidecarRecord[this.pending.size];
+        for (var i = 0; i < records.length; i++) {
+            records[i] = (SidecarRecord) this.pending[i];
+        }
+        this.pending.clear ();
+
+        if (this.store == null || records.length == 0) {
+            return false;
+        }
+
+        try {
+            this.store.save (records);
+        } catch (Error error) {
+            warning (_("Failed to save %d lookups to sidecar store: %s"),
+                     records.length,
+                     error.message);
+        }
+
+        return false;
+    }
+}
@@ -61,6 +61,12 @@ public class Rygel.SimpleContainer : Rygel.MediaContainer,
         this.search_classes = new ArrayList<string> ();
     }
 
+    ~SimpleContainer () {
+        foreach (var child in this.children) {
+            SimpleContainer.index_tree (child, false);
+        }
+    }
+
     /**
      * Creates a RygelSimpleContainer as a root container.
      *
@@ -129,6 +135,7 @@ public class Rygel.SimpleContainer : Rygel.MediaContainer,
      */
     public void remove_child (MediaObject child) {
         this.children.remove (child);
+        SimpleContainer.index_tree (child, false);
 
         this.child_count--;
     }
@@ -139,6 +146,9 @@ public class Rygel.SimpleContainer : Rygel.MediaContainer,
      */
     public void clear () {
         // TODO: this will have to emit sub-tree events of object being deleted.
+        foreach (var child in this.children) {
+            SimpleContainer.index_tree (child, false);
+        }
         this.children.clear ();
 
         this.child_count = 0;
@@ -205,6 +215,11 @@ public class Rygel.SimpleContainer : Rygel.MediaContainer,
     public override async MediaObject? find_object (string       id,
                                                     Cancellable? cancellable)
                                                     throws Error {
+        var indexed = ObjectIndex.get_default ().lookup (id, this);
+        if (indexed != null) {
+            return indexed;
+        }
+
         MediaObject media_object = null;
         var max_count = 0;
         var restart_count = 0;
@@ -283,10 +298,33 @@ public class Rygel.SimpleContainer : Rygel.MediaContainer,
 
     private void add_child (MediaObject child) {
         this.children.add (child);
+        SimpleContainer.index_tree (child, true);
 
         this.child_count++;
     }
 
+    /**
+     * Add @object and everything visible below it to the ObjectIndex, or
+     * remove it.
+     *
+     * The children of a container stay linked to it when it is removed,
+     * so the whole subtree has to go.
+     */
+    private static void index_tree (MediaObject object, bool add) {
+        if (add) {
+            ObjectIndex.get_default ().add (object);
+        } else {
+            ObjectIndex.get_default ().remove (object);
+        }
+
+        var container = object as SimpleContainer;
+        if (container != null) {
+            foreach (var child in container.children) {
+                SimpleContainer.index_tree (child, add);
+            }
+        }
+    }
+
     private void on_container_updated (MediaContainer source,
                                        MediaContainer updated,
                                        MediaObject object,
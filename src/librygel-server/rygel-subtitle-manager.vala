@@ -42,6 +42,48 @@ internal class Rygel.SubtitleManager : GLib.Object {
         return manager;
     }
 
+    // FIXME: foreach ".eng.srt", ".ger.srt", ".srt"...
+    // FIXME: case insensitive?
+    private const string[] EXTENSIONS = { "srt", "smi", "ssa" };
+
+    /**
+     * Check whether @file is looked for as a subtitle of a video.
+     */
+    public static bool is_subtitle (File file) {
+        var basename = file.get_basename ();
+        if (basename == null) {
+            return false;
+        }
+
+        var ext_index = basename.last_index_of_char ('.');
+        if (ext_index < 0) {
+            return false;
+        }
+
+        return basename.substring (ext_index + 1) in EXTENSIONS;
+    }
+
+    /**
+     * Get the SidecarCache group of the subtitles of @file.
+     *
+     * Videos and their subtitles share the name up to the extension, so
+     * this is the same for a video and all of its subtitles.
+     */
+    public static string get_group (File directory, File file) {
+        return "sub:" + directory.get_uri () + "/" +
+               SubtitleManager.get_stem (file);
+    }
+
+    private static string get_stem (File file) {
+        var basename = file.get_basename ();
+        var ext_index = basename.last_index_of_char ('.');
+        if (ext_index >= 0) {
+            basename = basename[0:ext_index];
+        }
+
+        return basename;
+    }
+
     public ArrayList<Subtitle> get_subtitles (string uri) throws Error {
         var video_file = File.new_for_uri (uri);
         if (!video_file.is_native ()) {
@@ -50,18 +92,48 @@ internal class Rygel.SubtitleManager : GLib.Object {
         }
 
         var directory = video_file.get_parent ();
-        var basename = video_file.get_basename ();
-        var ext_index = basename.last_index_of_char ('.');
-        if (ext_index >= 0) {
-            basename = basename[0:ext_index];
-        }
+        var group = SubtitleManager.get_group (directory, video_file);
 
-        // FIXME: foreach ".eng.srt", ".ger.srt", ".srt"...
-        // FIXME: case insensitive?
-        string[] exts = { "srt", "smi", "ssa" };
+        var cache = SidecarCache.get_default ();
+        var value = cache.lookup (group, "");
+        if (value == null) {
+            value = this.find_subtitles (directory, video_file);
+            cache.remember (group, "", value);
+        }
 
         var subtitles = new ArrayList<Subtitle> ();
-        foreach (string ext in exts) {
+        foreach (var line in value.split ("\n")) {
+            // uri, size, content type and extension of the subtitle
+            var fields = line.split ("\t", 4);
+            if (fields.length != 4) {
+                continue;
+            }
+
+            var subtitle = new Subtitle (fields[2], fields[3]);
+            subtitle.uri = fields[0];
+            subtitle.size = int64.parse (fields[1]);
+            subtitles.add (subtitle);
+        }
+
+        if (subtitles.size == 0) {
+            throw new SubtitleManagerError.NO_SUBTITLE
+                                        (_("No subtitle available"));
+        }
+
+        return subtitles;
+    }
+
+    /**
+     * Look for the subtitles of @video_file on disk.
+     *
+     * @return the subtitles found, one line each, in the format of the
+     * SidecarCache entry
+     */
+    private string find_subtitles (File directory, File video_file) {
+        var basename = SubtitleManager.get_stem (video_file);
+
+        var builder = new StringBuilder ();
+        foreach (string ext in EXTENSIONS) {
             string filename = basename + "." + ext;
 
             var subtitle_file = directory.get_child (filename);
@@ -78,11 +150,13 @@ internal class Rygel.SubtitleManager : GLib.Object {
                 if (info.get_attribute_boolean (FileAttribute.ACCESS_CAN_READ)) {
                     var content_type = info.get_attribute_string
                                         (FileAttribute.STANDARD_CONTENT_TYPE);
-                    var subtitle = new Subtitle (content_type, ext);
-                    subtitle.uri = subtitle_file.get_uri ();
-                    subtitle.size = (int64) info.get_attribute_uint64
+                    var size = info.get_attribute_uint64
                                         (FileAttribute.STANDARD_SIZE);
-                    subtitles.add (subtitle);
+                    builder.append_printf ("%s\t%s\t%s\t%s\n",
+                                           subtitle_file.get_uri (),
+                                           size.to_string (),
+                                           content_type ?? "",
+                                           ext);
                 }
             } catch (Error err) {
                 debug ("Failed to query file information for %s: %s",
@@ -91,11 +165,6 @@ internal class Rygel.SubtitleManager : GLib.Object {
             }
         }
 
-        if (subtitles.size == 0) {
-            throw new SubtitleManagerError.NO_SUBTITLE
-                                        (_("No subtitle available"));
-        }
-
-        return subtitles;
+        return builder.str;
     }
 }
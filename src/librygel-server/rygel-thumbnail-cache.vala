@@ -0,0 +1,188 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Contents of recently served thumbnails and album art.
+ *
+ * A client opening a folder requests the thumbnails of all items in it, and
+ * most clients do so again every time the folder is shown. These files are
+ * small, so they are kept in memory and sent without setting up a data
+ * source.
+ *
+ * The files are checked for changes at most every few seconds; in between,
+ * a request is answered without any file system access.
+ */
+internal class Rygel.ThumbnailCache : Object {
+    // Larger files are streamed as usual
+    public const int64 MAX_ENTRY_SIZE = 256 * 1024;
+
+    private const size_t MAX_SIZE = 8 * 1024 * 1024;
+    private const int64 REVALIDATE_INTERVAL = 10 * TimeSpan.SECOND;
+
+    /**
+     * A cached file.
+     */
+    public class Entry {
+        public Bytes data;
+        public string etag;
+        public string last_modified;
+
+        internal uint64 mtime;
+        internal int64 validated;
+
+        /**
+         * Check whether the copy of the client, as described by the
+         * conditional headers of its request, is still valid.
+         */
+        public bool is_fresh (Soup.MessageHeaders headers) {
+            var none_match = headers.get_list ("If-None-Match");
+            if (none_match != null) {
+                foreach (var item in none_match.split (",")) {
+                    var tag = item.strip ();
+                    if (tag.has_prefix ("W/")) {
+                        tag = tag.substring (2);
+                    }
+
+                    if (tag == "*" || tag == this.etag) {
+                        return true;
+                    }
+                }
+
+                // If-Modified-Since is ignored if If-None-Match is present
+                return false;
+            }
+
+            var modified_since = headers.get_one ("If-Modified-Since");
+            if (modified_since == null) {
+                return false;
+            }
+
+            var date = Soup.date_time_new_from_http_string (modified_since);
+
+            return date != null && (uint64) date.to_unix () >= this.mtime;
+        }
+    }
+
+    private static ThumbnailCache instance;
+
+    private LruCache<string, Entry> entries;
+    private size_t size;
+
+    public static ThumbnailCache get_default () {
+        if (ThumbnailCache.instance == null) {
+            ThumbnailCache.instance = new ThumbnailCache ();
+        }
+
+        return ThumbnailCache.instance;
+    }
+
+    private ThumbnailCache () {
+        this.entries = new LruCache<string, Entry> ();
+    }
+
+    /**
+     * Get the contents of the thumbnail at @uri.
+     *
+     * The file is read into the cache if it is not there yet.
+     *
+     * @return the entry, or null if the file cannot be read or is too large
+     * to be cached
+     */
+    public async Entry? lookup (string uri, Cancellable? cancellable) {
+        // Only local files are cheap enough to be checked for changes
+        if (!uri.has_prefix ("file:")) {
+            return null;
+        }
+
+        var now = get_monotonic_time ();
+        var entry = this.entries[uri];
+        if (entry != null && now - entry.validated < REVALIDATE_INTERVAL) {
+            return entry;
+        }
+
+        try {
+            var file = File.new_for_uri (uri);
+            var info = yield file.query_info_async
+                                        (FileAttribute.STANDARD_SIZE + "," +
+                                         FileAttribute.TIME_MODIFIED,
+                                         FileQueryInfoFlags.NONE,
+                                         Priority.DEFAULT,
+                                         cancellable);
+            var mtime = info.get_attribute_uint64
+                                        (FileAttribute.TIME_MODIFIED);
+
+            // The entry might have been replaced while waiting
+            entry = this.entries[uri];
+            if (entry != null &&
+                entry.mtime == mtime &&
+                entry.data.get_size () == (size_t) info.get_size ()) {
+                entry.validated = now;
+
+                return entry;
+            }
+
+            this.remove (uri);
+            if (info.get_size () > MAX_ENTRY_SIZE) {
+                return null;
+            }
+
+            uint8[] contents;
+            yield file.load_contents_async (cancellable, out contents, null);
+
+            var length = contents.length;
+            entry = new Entry ();
+            entry.data = new Bytes.take ((owned) contents);
+            entry.mtime = mtime;
+            entry.etag = "\"%s-%d\"".printf (mtime.to_string (), length);
+            var date = new DateTime.from_unix_utc ((int64) mtime);
+            entry.last_modified = Soup.date_time_to_string
+                                        (date,
+                                         Soup.DateFormat.HTTP);
+            entry.validated = now;
+            this.add (uri, entry);
+
+            return entry;
+        } catch (Error error) {
+            debug ("Failed to cache thumbnail %s: %s", uri, error.message);
+            this.remove (uri);
+
+            return null;
+        }
+    }
+
+    private void add (string uri, Entry entry) {
+        this.remove (uri);
+
+        var length = entry.data.get_size ();
+        Entry evicted;
+        while (this.size + length > MAX_SIZE &&
+               this.entries.evict (out evicted)) {
+            this.size -= evicted.data.get_size ();
+        }
+
+        this.entries[uri] = entry;
+        this.size += length;
+    }
+
+    private void remove (string uri) {
+        Entry entry;
+        if (this.entries.unset (uri, out entry)) {
+            this.size -= entry.data.get_size ();
+        }
+    }
+}
@@ -0,0 +1,386 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+/**
+ * Creates thumbnails of images on a pool of worker threads.
+ *
+ * The thumbnails are written to the cache defined by the freedesktop.org
+ * thumbnail managing standard, so they are shared with the desktop and
+ * found again through FileAttribute.THUMBNAIL_PATH. Images that cannot be
+ * thumbnailed get a failure marker in the cache as well.
+ *
+ * Thumbnails requested by a client are generated before those queued in the
+ * background, and all requests for the same file share one job.
+ */
+internal class Rygel.ThumbnailGenerator : Object {
+    // Size of the "normal" flavor
+    public const int SIZE = 128;
+
+    private const uint MAX_WORKERS = 2;
+    // Background requests beyond this are dropped; they are queued again
+    // the next time their item is created
+    private const uint MAX_QUEUED = 1024;
+
+    private class Waiter {
+        public SourceFunc callback;
+    }
+
+    private class Job {
+        public string uri;
+        public string path;
+        public string fail_path;
+        // Whether the job counts against MAX_QUEUED
+        public bool background;
+        // Guarded by the mutex of the generator
+        public bool started;
+        public int64 size;
+        public Error? error;
+        // Only used in the main context
+        public bool on_demand;
+        public ArrayList<Waiter> waiters;
+    }
+
+    /**
+     * An entry in the queue of the worker pool. A job may be queued more
+     * than once; the first ticket to run does the work.
+     *
+     * The pool sorts by the fields, so they never change once queued.
+     */
+    private class Ticket {
+        public Job job;
+        public bool on_demand;
+        public uint64 serial;
+    }
+
+    private string directory;
+    private string fail_directory;
+    private HashSet<string> mime_types;
+    private ThreadPool<Ticket> workers;
+    private MainContext context;
+    private HashMap<string, Job> jobs;
+    private uint queued;
+    private uint64 serial;
+    private Mutex mutex;
+
+    public ThumbnailGenerator () throws Error {
+        var cache = Path.build_filename (Environment.get_user_cache_dir (),
+                                         "thumbnails");
+        this.directory = Path.build_filename (cache, "normal");
+        this.fail_directory = Path.build_filename
+                                        (cache,
+                                         "fail",
+                                         "rygel-" +
+                                         BuildConfig.PACKAGE_VERSION);
+
+        foreach (var dir in new string[] { this.directory,
+                                           this.fail_directory }) {
+            if (DirUtils.create_with_parents (dir, 0700) != 0) {
+                throw new ThumbnailerError.NO_DIR
+                                        (_("Failed to create folder %s: %s"),
+                                         dir,
+                                         strerror (errno));
+            }
+        }
+
+        this.mime_types = new HashSet<string> ();
+        foreach (var format in Gdk.Pixbuf.get_formats ()) {
+            foreach (var mime_type in format.get_mime_types ()) {
+                this.mime_types.add (mime_type);
+            }
+        }
+
+        this.context = MainContext.ref_thread_default ();
+        this.jobs = new HashMap<string, Job> ();
+        this.workers = new ThreadPool<Ticket>.with_owned_data
+                                        (this.run_job,
+                                         (int) MAX_WORKERS,
+                                         false);
+        this.workers.set_sort_function (ThumbnailGenerator.compare_tickets);
+    }
+
+    /**
+     * Whether thumbnails can be created for files of @mime_type.
+     */
+    public bool supports (string mime_type) {
+        return mime_type in this.mime_types;
+    }
+
+    /**
+     * The path the thumbnail of @uri is stored at.
+     */
+    public string get_path (string uri) {
+        return Path.build_filename (this.directory,
+                                    ThumbnailGenerator.get_name (uri));
+    }
+
+    /**
+     * Whether creating a thumbnail of @uri failed since it was last
+     * modified.
+     *
+     * @param mtime the modification time of @uri in seconds
+     */
+    public bool has_failed (string uri, uint64 mtime) {
+        var file = File.new_for_path (Path.build_filename
+                                        (this.fail_directory,
+                                         ThumbnailGenerator.get_name (uri)));
+        try {
+            var info = file.query_info (FileAttribute.TIME_MODIFIED,
+                                        FileQueryInfoFlags.NONE);
+
+            return info.get_attribute_uint64 (FileAttribute.TIME_MODIFIED) >=
+                   mtime;
+        } catch (Error error) {
+            return false;
+        }
+    }
+
+    /**
+     * Create the thumbnail of @uri in the background.
+     */
+    public void queue (string uri) {
+        if (this.jobs.has_key (uri) || this.queued >= MAX_QUEUED) {
+            return;
+        }
+
+        this.queued++;
+        this.add_job (this.create_job (uri, false));
+    }
+
+    /**
+     * Create the thumbnail of @uri right away, or wait for the job already
+     * creating it.
+     *
+     * @return the size of the thumbnail file in bytes
+     */
+    public async int64 generate (string       uri,
+                                 Cancellable? cancellable) throws Error {
+        var job = this.jobs[uri];
+        if (job == null) {
+            job = this.create_job (uri, true);
+            this.add_job (job);
+        } else if (!job.on_demand) {
+            // Queue the job again ahead of the background ones; whichever
+            // ticket runs first does the work
+            job.on_demand = true;
+            this.queue_job (job);
+        }
+
+        var waiter = new Waiter ();
+        waiter.callback = this.generate.callback;
+        job.waiters.add (waiter);
+
+        ulong cancel_id = 0;
+        if (cancellable != null) {
+            cancel_id = cancellable.connect (() => {
+                var source = new IdleSource ();
+                source.set_callback (() => {
+                    if (job.waiters.remove (waiter)) {
+                        waiter.callback ();
+                    }
+
+                    return false;
+                });
+                source.attach (this.context);
+            });
+        }
+
+        yield;
+
+        if (cancellable != null) {
+            cancellable.disconnect (cancel_id);
+            cancellable.set_error_if_cancelled ();
+        }
+
+        if (job.error != null) {
+            throw job.error.copy ();
+        }
+
+        return job.size;
+    }
+
+    private static string get_name (string uri) {
+        return Checksum.compute_for_string (ChecksumType.MD5, uri) + ".png";
+    }
+
+    private static int compare_tickets (Ticket a, Ticket b) {
+        if (a.on_demand != b.on_demand) {
+            return a.on_demand ? -1 : 1;
+        }
+
+        return a.serial < b.serial ? -1 : (a.serial > b.serial ? 1 : 0);
+    }
+
+    private Job create_job (string uri, bool on_demand) {
+        var job = new Job ();
+        job.uri = uri;
+        job.path = this.get_path (uri);
+        job.fail_path = Path.build_filename (this.fail_directory,
+                                             ThumbnailGenerator.get_name
+                                                        (uri));
+        job.on_demand = on_demand;
+        job.background = !on_demand;
+        job.size = -1;
+        job.waiters = new ArrayList<Waiter> ();
+
+        return job;
+    }
+
+    private void add_job (Job job) {
+        this.jobs[job.uri] = job;
+
+        try {
+            this.queue_job (job);
+        } catch (ThreadError error) {
+            job.error = error;
+            this.finish_job (job);
+        }
+    }
+
+    private void queue_job (Job job) throws ThreadError {
+        var ticket = new Ticket ();
+        ticket.job = job;
+        ticket.on_demand = job.on_demand;
+        ticket.serial = ++this.serial;
+
+        this.workers.add (ticket);
+    }
+
+    // Runs on a worker thread
+    private void run_job (owned Ticket ticket) {
+        var job = ticket.job;
+
+        this.mutex.lock ();
+        var started = job.started;
+        job.started = true;
+        this.mutex.unlock ();
+
+        if (started) {
+            return;
+        }
+
+        try {
+            job.size = ThumbnailGenerator.create_thumbnail (job.uri,
+                                                            job.path,
+                                                            job.fail_path);
+        } catch (Error error) {
+            job.error = error;
+        }
+
+        var source = new IdleSource ();
+        source.set_callback (() => {
+            this.finish_job (job);
+
+            return false;
+        });
+        source.attach (this.context);
+    }
+
+    private void finish_job (Job job) {
+        this.jobs.unset (job.uri);
+        if (job.background) {
+            this.queued--;
+        }
+
+        if (job.error != null) {
+            debug ("Failed to create thumbnail for %s: %s",
+                   job.uri,
+                   job.error.message);
+        }
+
+        foreach (var waiter in job.waiters) {
+            waiter.callback ();
+        }
+        job.waiters.clear ();
+    }
+
+    // Runs on a worker thread
+    private static int64 create_thumbnail (string uri,
+                                           string path,
+                                           string fail_path) throws Error {
+        var file = File.new_for_uri (uri);
+        var info = file.query_info (FileAttribute.TIME_MODIFIED,
+                                    FileQueryInfoFlags.NONE);
+        var mtime = info.get_attribute_uint64
+                                        (FileAttribute.TIME_MODIFIED)
+                                        .to_string ();
+
+        Gdk.Pixbuf pixbuf;
+        try {
+            pixbuf = new Gdk.Pixbuf.from_file_at_scale (file.get_path (),
+                                                         SIZE,
+                                                         SIZE,
+                                                         true);
+            pixbuf = pixbuf.apply_embedded_orientation ();
+        } catch (Error error) {
+            // Remember the failure, so the file is not tried again until it
+            // changes
+            try {
+                var marker = new Gdk.Pixbuf (Gdk.Colorspace.RGB,
+                                             true,
+                                             8,
+                                             1,
+                                             1);
+                marker.fill (0);
+                ThumbnailGenerator.save (marker, fail_path, uri, mtime);
+            } catch (Error marker_error) { }
+
+            throw error;
+        }
+
+        ThumbnailGenerator.save (pixbuf, path, uri, mtime);
+
+        info = File.new_for_path (path).query_info
+                                        (FileAttribute.STANDARD_SIZE,
+                                         FileQueryInfoFlags.NONE);
+
+        return info.get_size ();
+    }
+
+    /**
+     * Write a thumbnail as demanded by the standard: with the URI and
+     * modification time of its source, readable only by the user, and
+     * atomically so no reader ever sees a partial file.
+     */
+    private static void save (Gdk.Pixbuf pixbuf,
+                              string     path,
+                              string     uri,
+                              string     mtime) throws Error {
+        var temp_path = "%s.%s".printf (path, Uuid.string_random ());
+
+        try {
+            pixbuf.savev (temp_path,
+                          "png",
+                          { "tEXt::Thumb::URI",
+                            "tEXt::Thumb::MTime",
+                            "tEXt::Software" },
+                          { uri, mtime, "Rygel" });
+            FileUtils.chmod (temp_path, 0600);
+            if (FileUtils.rename (temp_path, path) != 0) {
+                throw new FileError.FAILED (_("Failed to move %s: %s"),
+                                            temp_path,
+                                            strerror (errno));
+            }
+        } catch (Error error) {
+            FileUtils.unlink (temp_path);
+
+            throw error;
+        }
+    }
+}
@@ -30,6 +30,9 @@ internal errordomain ThumbnailerError {
 
 /**
  * Provides thumbnails for images and videos.
+ *
+ * Thumbnails of images are created in-process by ThumbnailGenerator. Other
+ * files are handed to the D-Bus thumbnailer service, if there is one.
  */
 internal class Rygel.Thumbnailer : GLib.Object {
     private static Thumbnailer thumbnailer; // Our singleton object
@@ -39,6 +42,7 @@ internal class Rygel.Thumbnailer : GLib.Object {
     private string extension;
 
     private DbusThumbnailer thumbler = null;
+    private ThumbnailGenerator generator = null;
 
     private Thumbnailer () throws ThumbnailerError {
         this.template = new Thumbnail ("image/png", "PNG_TN", "png");
@@ -47,6 +51,13 @@ internal class Rygel.Thumbnailer : GLib.Object {
         this.template.depth = 24;
         this.extension = "." + this.template.file_extension;
 
+        try {
+            this.generator = new ThumbnailGenerator ();
+        } catch (Error error) {
+            warning (_("Failed to set up thumbnail creation: %s"),
+                     error.message);
+        }
+
         try {
             this.thumbler = new DbusThumbnailer ();
             this.thumbler.ready.connect (this.on_dbus_thumbnailer_ready);
@@ -75,7 +86,8 @@ internal class Rygel.Thumbnailer : GLib.Object {
         }
 
         var info = file.query_info (FileAttribute.THUMBNAIL_PATH + "," +
-                                    FileAttribute.THUMBNAILING_FAILED,
+                                    FileAttribute.THUMBNAILING_FAILED + "," +
+                                    FileAttribute.TIME_MODIFIED,
                                     FileQueryInfoFlags.NONE);
         var path = info.get_attribute_as_string (FileAttribute.THUMBNAIL_PATH);
         var failed = info.get_attribute_boolean
@@ -88,6 +100,28 @@ internal class Rygel.Thumbnailer : GLib.Object {
                                         (_("No thumbnail available"));
         }
 
+        // Create the thumbnail in the background. Until it is done, it is
+        // created when a client requests it, see ensure_thumbnail ()
+        if (this.generator != null &&
+            path == null &&
+            mime_type != null &&
+            this.generator.supports (mime_type)) {
+            var mtime = info.get_attribute_uint64
+                                        (FileAttribute.TIME_MODIFIED);
+            if (this.generator.has_failed (uri, mtime)) {
+                throw new ThumbnailerError.NO_THUMBNAIL
+                                        (_("No thumbnail available"));
+            }
+
+            this.generator.queue (uri);
+
+            var thumbnail = this.create_thumbnail ();
+            thumbnail.uri = Filename.to_uri (this.generator.get_path (uri),
+                                             null);
+
+            return thumbnail;
+        }
+
         // Send a request to create thumbnail if it does not exist, signal
         // that there's no thumbnail available now.
         if (this.thumbler != null && path == null && mime_type != null) {
@@ -113,15 +147,58 @@ internal class Rygel.Thumbnailer : GLib.Object {
                                         (_("No thumbnail available"));
         }
 
+        var thumbnail = this.create_thumbnail ();
+        thumbnail.uri = Filename.to_uri (path, null);
+        thumbnail.size = (int64) info.get_attribute_uint64
+                                        (FileAttribute.STANDARD_SIZE);
+
+        return thumbnail;
+    }
+
+    /**
+     * Make sure the file of @thumbnail exists.
+     *
+     * Thumbnails returned by get_thumbnail () before their file was created
+     * have no size. Their file is created now, ahead of those queued in the
+     * background. Concurrent requests for the same thumbnail wait for the
+     * same job.
+     *
+     * @param thumbnail a thumbnail returned by get_thumbnail ()
+     * @param uri the URI of the file the thumbnail is for
+     */
+    public async void ensure_thumbnail (Thumbnail    thumbnail,
+                                        string       uri,
+                                        Cancellable? cancellable)
+                                        throws Error {
+        if (thumbnail.size >= 0 || this.generator == null) {
+            return;
+        }
+
+        var path = this.generator.get_path (uri);
+        if (thumbnail.uri != Filename.to_uri (path, null)) {
+            return;
+        }
+
+        if (FileUtils.test (path, FileTest.EXISTS)) {
+            var info = File.new_for_path (path).query_info
+                                        (FileAttribute.STANDARD_SIZE,
+                                         FileQueryInfoFlags.NONE,
+                                         cancellable);
+            thumbnail.size = info.get_size ();
+
+            return;
+        }
+
+        thumbnail.size = yield this.generator.generate (uri, cancellable);
+    }
+
+    private Thumbnail create_thumbnail () {
         var thumbnail = new Thumbnail (this.template.mime_type,
                                        this.template.dlna_profile,
                                        this.template.file_extension);
         thumbnail.width = this.template.width;
         thumbnail.height = this.template.height;
         thumbnail.depth = this.template.depth;
-        thumbnail.uri = Filename.to_uri (path, null);
-        thumbnail.size = (int64) info.get_attribute_uint64
-                                        (FileAttribute.STANDARD_SIZE);
 
         return thumbnail;
     }
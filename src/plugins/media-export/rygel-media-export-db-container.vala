@@ -72,10 +72,11 @@ public class Rygel.MediaExport.DBContainer : MediaContainer,
                                                      string       sort_criteria,
                                                      Cancellable? cancellable)
                                                      throws GLib.Error {
-        return this.media_db.get_children (this,
-                                           sort_criteria,
-                                           offset,
-                                           max_count);
+        return yield this.media_db.get_children (this,
+                                                 sort_criteria,
+                                                 offset,
+                                                 max_count,
+                                                 cancellable);
     }
 
     public virtual async MediaObjects? search (SearchExpression? expression,
@@ -88,12 +89,13 @@ public class Rygel.MediaExport.DBContainer : MediaContainer,
         MediaObjects children = null;
 
         try {
-            children = this.media_db.get_objects_by_search_expression
+            children = yield this.media_db.get_objects_by_search_expression
                                         (expression,
                                          this.id,
                                          sort_criteria,
                                          offset,
                                          max_count,
+                                         cancellable,
                                          out total_matches);
         } catch (MediaCacheError error) {
             if (error is MediaCacheError.UNSUPPORTED_SEARCH) {
@@ -114,6 +116,6 @@ public class Rygel.MediaExport.DBContainer : MediaContainer,
     public override async MediaObject? find_object (string       id,
                                                     Cancellable? cancellable)
                                                     throws Error {
-        return this.media_db.get_object (id);
+        return yield this.media_db.get_cached_object (id, cancellable);
     }
 }
@@ -26,10 +26,24 @@ using Gee;
 internal class Rygel.MediaExport.Harvester : GLib.Object {
     private const uint FILE_CHANGE_DEFAULT_GRACE_PERIOD = 5;
 
+    /// Seconds without client activity after which throttling is lifted
+    private const uint STREAM_ACTIVITY_WINDOW = 10;
+
+    /// Seconds a deleted file is kept around in case it re-appears elsewhere
+    private const uint MOVE_DETECTION_WINDOW = 10;
+
+    /// How often removal is postponed while harvesting is still running
+    private const uint MOVE_DETECTION_MAX_DELAYS = 6;
+
     private HashMap<File, HarvestingTask> tasks;
     private HashMap<File, uint> extraction_grace_timers;
     private RecursiveFileMonitor monitor;
     private Cancellable cancellable;
+    private uint throttle_timeout = 0;
+    private uint active_streams = 0;
+    private ArrayList<File> pending_removals;
+    private uint removal_timeout = 0;
+    private uint removal_delays = 0;
 
     // Properties
     public ArrayList<File> locations { get; private set; }
@@ -58,6 +72,8 @@ internal class Rygel.MediaExport.Harvester : GLib.Object {
         this.extraction_grace_timers = new HashMap<File, uint>
                                         ((HashDataFunc<File>) File.hash,
                                          (EqualDataFunc<File>) File.equal);
+        this.pending_removals = new ArrayList<File>
+                                        ((EqualDataFunc<File>) File.equal);
     }
 
     /**
@@ -127,6 +143,7 @@ internal class Rygel.MediaExport.Harvester : GLib.Object {
                                        file,
                                        parent);
         task.cancellable = this.cancellable;
+        task.throttled = this.is_throttled ();
         task.completed.connect (this.on_file_harvested);
         this.tasks[file] = task;
         task.run.begin ();
@@ -146,6 +163,77 @@ internal class Rygel.MediaExport.Harvester : GLib.Object {
         }
     }
 
+    /**
+     * Tell the running harvesting tasks that a client is interested in an
+     * object.
+     *
+     * Pending files matching the id, or living in the container with that
+     * id, are extracted before the rest of the background work.
+     *
+     * @param id id of the object a client requested
+     */
+    public void prioritize (string id) {
+        if (this.tasks.is_empty) {
+            return;
+        }
+
+        foreach (var task in this.tasks.values) {
+            task.prioritize (id);
+        }
+    }
+
+    /**
+     * Signal that a client started streaming a resource.
+     *
+     * Background extraction is slowed down until all streams have finished
+     * and no new one was started for STREAM_ACTIVITY_WINDOW seconds.
+     */
+    public void stream_started () {
+        if (!this.is_throttled ()) {
+            debug ("Client activity detected, throttling harvesting");
+            this.set_throttled (true);
+        }
+
+        this.active_streams++;
+        if (this.throttle_timeout != 0) {
+            Source.remove (this.throttle_timeout);
+            this.throttle_timeout = 0;
+        }
+    }
+
+    /**
+     * Signal that a stream announced with stream_started () has finished.
+     */
+    public void stream_finished () {
+        if (this.active_streams == 0) {
+            return;
+        }
+
+        this.active_streams--;
+        if (this.active_streams > 0) {
+            return;
+        }
+
+        this.throttle_timeout = Timeout.add_seconds (STREAM_ACTIVITY_WINDOW,
+                                                     () => {
+            debug ("No client activity anymore, resuming harvesting");
+            this.throttle_timeout = 0;
+            this.set_throttled (false);
+
+            return false;
+        });
+    }
+
+    private bool is_throttled () {
+        return this.active_streams > 0 || this.throttle_timeout != 0;
+    }
+
+    private void set_throttled (bool throttled) {
+        foreach (var task in this.tasks.values) {
+            task.throttled = throttled;
+        }
+    }
+
     /**
      * Callback for finished harvester.
      *
@@ -166,6 +254,12 @@ internal class Rygel.MediaExport.Harvester : GLib.Object {
     private void on_file_changed (File             file,
                                   File?            other,
                                   FileMonitorEvent event) {
+        if (event == FileMonitorEvent.CREATED ||
+            event == FileMonitorEvent.CHANGES_DONE_HINT ||
+            event == FileMonitorEvent.DELETED) {
+            SidecarCache.get_default ().file_changed (file);
+        }
+
         try {
             switch (event) {
                 case FileMonitorEvent.CREATED: {
@@ -226,13 +320,57 @@ internal class Rygel.MediaExport.Harvester : GLib.Object {
     }
 
     private void on_file_removed (File file) {
-        var cache = MediaCache.get_default ();
         if (this.extraction_grace_timers.has_key (file)) {
             Source.remove (this.extraction_grace_timers[file]);
             this.extraction_grace_timers.unset (file);
         }
 
         this.cancel (file);
+
+        // A move shows up as a deletion and a creation. Keep the cached
+        // object for a while so the harvesting of the new location can take
+        // over its meta-data.
+        if (!this.pending_removals.contains (file)) {
+            this.pending_removals.add (file);
+        }
+
+        if (this.removal_timeout == 0) {
+            this.removal_timeout = Timeout.add_seconds
+                                        (MOVE_DETECTION_WINDOW,
+                                         this.on_removal_timeout);
+        }
+    }
+
+    private bool on_removal_timeout () {
+        var busy = !this.tasks.is_empty ||
+                   !this.extraction_grace_timers.is_empty;
+        if (busy && this.removal_delays < MOVE_DETECTION_MAX_DELAYS) {
+            this.removal_delays++;
+
+            return true;
+        }
+
+        this.removal_timeout = 0;
+        this.removal_delays = 0;
+
+        var files = this.pending_removals;
+        this.pending_removals = new ArrayList<File>
+                                        ((EqualDataFunc<File>) File.equal);
+        foreach (var file in files) {
+            // Re-created in place in the meantime
+            if (file.query_exists ()) {
+                continue;
+            }
+
+            this.remove_file (file);
+        }
+
+        return false;
+    }
+
+    private void remove_file (File file) {
+        var cache = MediaCache.get_default ();
+
         try {
             // the full object is fetched instead of simply calling
             // exists because we need the parent to signal the
@@ -240,7 +378,10 @@ internal class Rygel.MediaExport.Harvester : GLib.Object {
             var id = MediaCache.get_id (file);
             var object = cache.get_object (id);
 
-            if (object != null && object.parent != null) {
+            if (object == null) {
+                debug ("%s is not cached anymore, probably moved",
+                       file.get_uri ());
+            } else if (object.parent != null) {
                 var parent = object.parent;
 
                 if (parent is WritableDbContainer) {
@@ -22,15 +22,72 @@ using GLib;
 using Gee;
 using Gst.PbUtils;
 
+/**
+ * Relative urgency of a file waiting for meta-data extraction.
+ *
+ * Files that are not wanted by anyone are extracted in directory-walk order,
+ * files a client is looking at right now jump the queue.
+ */
+internal enum Rygel.MediaExport.HarvestingPriority {
+    BACKGROUND,
+    BROWSED,
+    REQUESTED
+}
+
 internal class FileQueueEntry {
     public File file;
+    public string id;
     public bool known;
     public string content_type;
-
-    public FileQueueEntry (File file, bool known, string content_type) {
+    public MediaContainer parent;
+    public bool indexed;
+    public Rygel.MediaExport.HarvestingPriority priority;
+    public uint serial;
+    public bool superseded;
+
+    public FileQueueEntry (File           file,
+                           bool           known,
+                           string         content_type,
+                           MediaContainer parent,
+                           uint           serial) {
         this.file = file;
+        this.id = Rygel.MediaExport.MediaCache.get_id (file);
         this.known = known;
         this.content_type = content_type;
+        this.parent = parent;
+        this.indexed = false;
+        this.priority = Rygel.MediaExport.HarvestingPriority.BACKGROUND;
+        this.serial = serial;
+        this.superseded = false;
+    }
+
+    public FileQueueEntry copy (Rygel.MediaExport.HarvestingPriority priority) {
+        var entry = new FileQueueEntry (this.file,
+                                        this.known,
+                                        this.content_type,
+                                        this.parent,
+                                        this.serial);
+        entry.indexed = this.indexed;
+        entry.priority = priority;
+
+        return entry;
+    }
+
+    /**
+     * Order entries by priority first and by the order they were discovered
+     * in second, so that equally important files keep the directory-walk
+     * order.
+     */
+    public static int compare (FileQueueEntry a, FileQueueEntry b) {
+        if (a.priority != b.priority) {
+            return (int) b.priority - (int) a.priority;
+        }
+
+        if (a.serial == b.serial) {
+            return 0;
+        }
+
+        return a.serial < b.serial ? -1 : 1;
     }
 }
 
@@ -40,19 +97,38 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
     private Timer timer;
     private MetadataExtractor extractor;
     private MediaCache cache;
-    private GLib.Queue<MediaContainer> containers;
+    private Gee.Deque<DummyContainer> containers;
+    private Gee.Deque<DummyContainer> requested_containers;
+    private HashMap<string, DummyContainer> pending_containers;
     private Gee.Queue<FileQueueEntry> files;
+    private HashMap<string, FileQueueEntry> pending_files;
+    private HashMultiMap<string, string> pending_children;
+    private FileQueueEntry current;
+    private Gee.List<string> vanished;
+    private uint serial;
     private RecursiveFileMonitor monitor;
     private MediaContainer parent;
     private const int BATCH_SIZE = 256;
 
+    /// Delay between two background extractions while throttled, in ms
+    private const uint THROTTLE_DELAY = 500;
+
     public Cancellable cancellable { get; set; }
 
+    /**
+     * If set, files nobody asked for are extracted at a reduced rate to keep
+     * the I/O and CPU load down while clients are streaming.
+     */
+    public bool throttled { get; set; default = false; }
+
     private const string HARVESTER_ATTRIBUTES =
                                         FileAttribute.STANDARD_NAME + "," +
+                                        FileAttribute.STANDARD_DISPLAY_NAME + "," +
                                         FileAttribute.STANDARD_TYPE + "," +
                                         FileAttribute.STANDARD_SIZE + "," +
                                         FileAttribute.TIME_MODIFIED + "," +
+                                        FileAttribute.UNIX_DEVICE + "," +
+                                        FileAttribute.UNIX_INODE + "," +
                                         FileAttribute.STANDARD_IS_HIDDEN + "," +
                                         FileAttribute.STANDARD_SYMLINK_TARGET;
 
@@ -70,8 +146,13 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
         this.extractor.extraction_done.connect (this.on_extracted_cb);
         this.extractor.error.connect (this.on_extractor_error_cb);
 
-        this.files = new LinkedList<FileQueueEntry> ();
-        this.containers = new GLib.Queue<MediaContainer> ();
+        this.files = new PriorityQueue<FileQueueEntry> (FileQueueEntry.compare);
+        this.pending_files = new HashMap<string, FileQueueEntry> ();
+        this.pending_children = new HashMultiMap<string, string> ();
+        this.containers = new LinkedList<DummyContainer> ();
+        this.requested_containers = new LinkedList<DummyContainer> ();
+        this.pending_containers = new HashMap<string, DummyContainer> ();
+        this.vanished = new ArrayList<string> ();
         this.monitor = monitor;
         this.timer = new Timer ();
     }
@@ -88,6 +169,127 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
         this.extractor.stop ();
     }
 
+    /**
+     * Move work related to an object a client is interested in to the front
+     * of the queue.
+     *
+     * If @id is the id of a file waiting for extraction, it will be the next
+     * one to be extracted. If it is the id of a container, all of its
+     * pending files are extracted before any background work and, if the
+     * container itself has not been enumerated yet, it will be the next one
+     * to be enumerated.
+     *
+     * @param id the id of the requested item or the browsed container
+     */
+    internal void prioritize (string id) {
+        var count = 0;
+
+        var entry = this.pending_files[id];
+        if (entry != null && entry.priority < HarvestingPriority.REQUESTED) {
+            this.bump (entry, HarvestingPriority.REQUESTED);
+            count++;
+        }
+
+        if (this.pending_children.contains (id)) {
+            foreach (var child_id in this.pending_children[id]) {
+                var child = this.pending_files[child_id];
+                if (child != null &&
+                    child.parent.id == id &&
+                    child.priority < HarvestingPriority.BROWSED) {
+                    this.bump (child, HarvestingPriority.BROWSED);
+                    count++;
+                }
+            }
+
+            // All of them are at least browsed now, no need to look at
+            // them again the next time the container is requested
+            this.pending_children.remove_all (id);
+        }
+
+        var pending = this.pending_containers[id];
+        if (pending != null) {
+            this.requested_containers.offer_head (pending);
+        }
+
+        if (count > 0 || pending != null) {
+            debug ("Prioritized %d files%s for %s on client request",
+                   count,
+                   pending != null ? " and the enumeration" : "",
+                   id);
+        }
+    }
+
+    /**
+     * The priority is part of the queue's sort key, so it cannot be changed
+     * while the entry is queued. Instead, the entry is marked as superseded
+     * and skipped once it comes up, and a copy is queued in its place.
+     */
+    private void bump (FileQueueEntry     entry,
+                       HarvestingPriority priority) {
+        entry.superseded = true;
+        var copy = entry.copy (priority);
+        this.pending_files[copy.id] = copy;
+        this.files.offer (copy);
+    }
+
+    private void queue_file (FileQueueEntry entry) {
+        var old = this.pending_files[entry.id];
+        if (old != null) {
+            old.superseded = true;
+            if (old.priority > entry.priority) {
+                entry.priority = old.priority;
+            }
+        }
+
+        this.pending_files[entry.id] = entry;
+        this.pending_children[entry.parent.id] = entry.id;
+        this.files.offer (entry);
+    }
+
+    private FileQueueEntry? peek_file () {
+        while (!this.files.is_empty && this.files.peek ().superseded) {
+            this.files.poll ();
+        }
+
+        return this.files.peek ();
+    }
+
+    private FileQueueEntry? poll_file () {
+        var entry = this.peek_file ();
+        if (entry != null) {
+            this.files.poll ();
+            this.pending_files.unset (entry.id);
+            this.pending_children.remove (entry.parent.id, entry.id);
+        }
+
+        return entry;
+    }
+
+    private void queue_container (DummyContainer container) {
+        this.pending_containers[container.id] = container;
+        this.containers.offer_tail (container);
+    }
+
+    /**
+     * Containers a client asked for come first. They stay in the background
+     * queue as well, so anything that was already taken from the other
+     * queue is skipped.
+     */
+    private DummyContainer? poll_container () {
+        DummyContainer container = null;
+        do {
+            container = this.requested_containers.poll_head () ??
+                        this.containers.poll_head ();
+        } while (container != null &&
+                 this.pending_containers[container.id] != container);
+
+        if (container != null) {
+            this.pending_containers.unset (container.id);
+        }
+
+        return container;
+    }
+
     /**
      * Extract all metainformation from a given file.
      *
@@ -102,6 +304,12 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
      *
      * No matter how many children are contained within file's hierarchy,
      * only one event is sent when all the children are done.
+     *
+     * Harvesting happens in two phases. While the directories are enumerated,
+     * new files are immediately published with the basic information from
+     * the file system. Once all directories are known, the deep meta-data
+     * extraction runs over the queued files in the background and updates
+     * the published items in place.
      */
     public async void run () {
         this.timer.reset ();
@@ -115,9 +323,6 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
                                          this.cancellable);
 
             if (this.process_file (this.origin, info, this.parent)) {
-                if (info.get_file_type () != FileType.DIRECTORY) {
-                    this.containers.push_tail (this.parent);
-                }
                 this.on_idle ();
             } else {
                 this.completed ();
@@ -150,19 +355,30 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
      *             mime type)
      * @return true, if the file has been queued, false otherwise.
      */
-    private bool push_if_changed_or_unknown (File       file,
-                                             FileInfo   info) {
+    private bool push_if_changed_or_unknown (File           file,
+                                             FileInfo       info,
+                                             MediaContainer parent) {
         try {
             int64 timestamp;
             int64 size;
             string mime_type;
+            bool has_identity;
 
-            bool is_cached = this.cache.exists (file, out timestamp, out size, out mime_type);
+            bool is_cached = this.cache.exists (file,
+                                                out timestamp,
+                                                out size,
+                                                out mime_type,
+                                                out has_identity);
             if (is_cached) {
                 int64 mtime = (int64) info.get_attribute_uint64
                                         (FileAttribute.TIME_MODIFIED);
                 if (mtime <= timestamp &&
                     info.get_size () == size) {
+                    // Files cached by older versions do not have one yet
+                    if (!has_identity) {
+                        this.cache.save_file_identity (file, info);
+                    }
+
                     return false;
                 }
 
@@ -184,10 +400,22 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
                 return false;
             }
 
+            if (!is_cached && this.adopt_moved_file (file, info, parent)) {
+                return false;
+            }
+
+            this.cache.save_file_identity (file, info);
+
             var entry = new FileQueueEntry (file,
                                             is_cached,
-                                            info.get_content_type ());
-            this.files.offer (entry);
+                                            info.get_content_type (),
+                                            parent,
+                                            this.serial++);
+            if (!is_cached) {
+                entry.indexed = this.index_basic (file, info, parent);
+                entry.known = entry.indexed;
+            }
+            this.queue_file (entry);
 
             return true;
         } catch (Error error) {
@@ -197,6 +425,112 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
         return false;
     }
 
+    /**
+     * Check whether a file new to the cache was moved or renamed from a
+     * location that is still cached, and re-use the cached meta-data
+     * instead of extracting it again.
+     *
+     * The file is matched by device, inode, size and mtime. Its old row is
+     * only removed after the new one is saved, so a moved folder never
+     * loses its items' meta-data regardless of the order the old and new
+     * location are scanned in.
+     *
+     * @return true if the file was taken over from its old location
+     */
+    private bool adopt_moved_file (File           file,
+                                   FileInfo       info,
+                                   MediaContainer parent) {
+        try {
+            var old_uri = this.cache.find_moved_file (file, info);
+            if (old_uri == null) {
+                return false;
+            }
+
+            var old_file = File.new_for_uri (old_uri);
+
+            // Still there, so this is a hard link and not a move
+            if (old_file.query_exists (this.cancellable)) {
+                return false;
+            }
+
+            // The title may have been derived from the old file name, so a
+            // renamed file needs to go through extraction again
+            if (old_file.get_basename () != file.get_basename ()) {
+                return false;
+            }
+
+            var old_id = MediaCache.get_id (old_file);
+            var item = this.cache.get_object (old_id) as MediaFileItem;
+            if (item == null) {
+                return false;
+            }
+
+            debug ("%s was moved to %s, re-using cached meta-data",
+                   old_uri,
+                   file.get_uri ());
+
+            // The old entry has to be removed while the item still has its
+            // old id and location; only then it is re-used for the new one
+            var old_parent = item.parent as TrackableContainer;
+            if (old_parent != null) {
+                old_parent.remove_child_tracked.begin (item, (object, res) => {
+                    this.add_moved_item (item, file, info, parent);
+                });
+            } else {
+                this.cache.remove_by_id (old_id);
+                this.add_moved_item (item, file, info, parent);
+            }
+
+            return true;
+        } catch (Error error) {
+            debug ("Failed to check whether %s was moved: %s",
+                   file.get_uri (),
+                   error.message);
+        }
+
+        return false;
+    }
+
+    private void add_moved_item (MediaFileItem  item,
+                                 File           file,
+                                 FileInfo       info,
+                                 MediaContainer parent) {
+        item.id = MediaCache.get_id (file);
+        item.get_uris ().clear ();
+        item.add_uri (file.get_uri ());
+        item.parent_ref = parent;
+        ((TrackableContainer) parent).add_child_tracked.begin (item);
+        this.cache.save_file_identity (file, info);
+    }
+
+    /**
+     * First harvesting phase: make a new file browsable right away, using
+     * only what is known from enumerating its directory.
+     *
+     * @return true if an item was published for the file
+     */
+    private bool index_basic (File           file,
+                              FileInfo       info,
+                              MediaContainer parent) {
+        try {
+            var item = ItemFactory.create_from_info (parent, file, info);
+            if (item == null) {
+                return false;
+            }
+
+            item.parent_ref = parent;
+            ((TrackableContainer) parent).add_child_tracked.begin (item);
+
+            return true;
+        } catch (Error error) {
+            debug ("Failed to create basic item for %s: %s",
+                   file.get_uri (),
+                   error.message);
+        }
+
+        return false;
+    }
+
     private bool process_file (File           file,
                                FileInfo       info,
                                MediaContainer parent) {
@@ -221,7 +555,7 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
             this.monitor.add.begin (file);
 
             var container = new DummyContainer (file, parent);
-            this.containers.push_tail (container);
+            this.queue_container (container);
 
             // Only add new containers. There's not much about a container so
             // we skip the updated signal
@@ -233,17 +567,16 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
 
             return true;
         } else {
-            return this.push_if_changed_or_unknown (file, info);
+            return this.push_if_changed_or_unknown (file, info, parent);
         }
     }
 
-    private bool process_children (GLib.List<FileInfo>? list) {
+    private bool process_children (DummyContainer       container,
+                                   GLib.List<FileInfo>? list) {
         if (list == null || this.cancellable.is_cancelled ()) {
             return false;
         }
 
-        var container = this.containers.peek_head () as DummyContainer;
-
         foreach (var info in list) {
             var file = container.file.get_child (info.get_name ());
 
@@ -255,7 +588,10 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
     }
 
     private async void enumerate_directory () {
-        var directory = ((DummyContainer) this.containers.peek_head ()).file;
+        // Take the container off the queue right away so a concurrent
+        // prioritize () cannot re-order it under our feet
+        var container = this.poll_container ();
+        var directory = container.file;
         try {
             var enumerator = yield directory.enumerate_children_async
                                         (HARVESTER_ATTRIBUTES,
@@ -268,7 +604,7 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
                 list = yield enumerator.next_files_async (BATCH_SIZE,
                                                           Priority.DEFAULT,
                                                           this.cancellable);
-            } while (this.process_children (list));
+            } while (this.process_children (container, list));
 
             yield enumerator.close_async (Priority.DEFAULT, this.cancellable);
         } catch (Error err) {
@@ -277,23 +613,28 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
                      err.message);
         }
 
-        this.cleanup_database ();
-        this.do_update ();
+        this.cleanup_database (container);
+        this.on_idle ();
     }
 
-    private void cleanup_database () {
-        var container = this.containers.peek_head () as DummyContainer;
+    private void cleanup_database (DummyContainer container) {
+        // Children which are not in the file system anymore are only
+        // removed once all directories have been enumerated, since they
+        // might turn up in another directory, see adopt_moved_file ()
+        this.vanished.add_all (container.children);
+    }
 
-        // delete all children which are not in filesystem anymore
+    private void remove_vanished () {
         try {
-            foreach (var child in container.children) {
+            foreach (var child in this.vanished) {
                 this.cache.remove_by_id (child);
             }
         } catch (Database.DatabaseError error) {
-            warning (_("Failed to get children of container %s: %s"),
-                     container.id,
+            warning (_("Failed to remove vanished objects: %s"),
                      error.message);
         }
+
+        this.vanished.clear ();
     }
 
     private bool on_idle () {
@@ -303,15 +644,27 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
             return false;
         }
 
-        if (!this.files.is_empty) {
-            debug ("Scheduling file %s for meta-data extraction…",
-                   this.files.peek ().file.get_uri ());
-            this.extractor.extract (this.files.peek ().file,
-                                    this.files.peek ().content_type);
-        } else if (!this.containers.is_empty ()) {
+        var next = this.peek_file ();
+        var is_background = next == null ||
+                            next.priority == HarvestingPriority.BACKGROUND;
+
+        if (!is_background) {
+            this.extract_next ();
+        } else if (!this.pending_containers.is_empty) {
             this.enumerate_directory.begin ();
+        } else if (!this.pending_files.is_empty) {
+            this.remove_vanished ();
+
+            if (this.throttled) {
+                Timeout.add (THROTTLE_DELAY, this.on_throttle_delay);
+
+                return false;
+            }
+
+            this.extract_next ();
         } else {
             // nothing to do
+            this.remove_vanished ();
             this.completed ();
             message ("Harvesting of %s done in %f",
                     origin.get_uri (),
@@ -321,10 +674,46 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
         return false;
     }
 
+    /**
+     * Extract one file after waiting while throttled, so background
+     * harvesting slows down but does not stop while clients are streaming.
+     */
+    private bool on_throttle_delay () {
+        if (this.cancellable.is_cancelled () ||
+            this.pending_files.is_empty ||
+            !this.pending_containers.is_empty) {
+            return this.on_idle ();
+        }
+
+        this.extract_next ();
+
+        return false;
+    }
+
+    private void extract_next () {
+        this.current = this.poll_file ();
+        debug ("Scheduling file %s for meta-data extraction…",
+               this.current.file.get_uri ());
+        this.extractor.extract (this.current.file,
+                                this.current.content_type);
+    }
+
+    /**
+     * Continue with the next file once the main loop has nothing more
+     * important to do, so the deep extraction does not compete with
+     * clients.
+     */
+    private void schedule_next () {
+        this.current = null;
+        Idle.add (this.on_idle, Priority.LOW);
+    }
+
     private void on_extracted_cb (File               file,
                                   Variant?           info) {
-        if (!file.equal (this.files.peek ().file)) {
+        if (this.current == null || !file.equal (this.current.file)) {
             debug ("Not for us, ignoring");
+
+            return;
         }
 
         if (this.cancellable.is_cancelled ()) {
@@ -332,16 +721,23 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
         }
 
         try {
-            var parent = this.containers.peek_head ();
+            var parent = this.current.parent;
             var item = ItemFactory.create_from_variant (parent,
                                                         file,
                                                         info);
 
             if (item != null) {
                 item.parent_ref = parent;
+
+                // The extractor may have stored new art for the item
+                var art_store = MediaArtStore.get_default ();
+                if (item is MusicItem && art_store != null) {
+                    art_store.forget ((MusicItem) item);
+                }
+
                 // This is only necessary to generate the proper <objAdd LastChange
                 // entry
-                if (this.files.peek ().known) {
+                if (this.current.known) {
                     ((UpdatableObject) item).non_overriding_commit.begin ();
                 } else {
                     var container = (TrackableContainer) item.parent;
@@ -353,8 +749,7 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
                      error.message);
         }
 
-        this.files.poll ();
-        this.do_update ();
+        this.schedule_next ();
     }
 
     private void on_extractor_error_cb (File file, Error error) {
@@ -368,21 +763,24 @@ public class Rygel.MediaExport.HarvestingTask : Rygel.StateMachine,
 
         this.cache.ignore (file);
 
-        this.files.poll ();
-        this.do_update ();
+        // Take back the basic item published in the first phase
+        if (this.current != null && this.current.indexed) {
+            this.remove_basic_item (this.current);
+        }
+
+        this.schedule_next ();
     }
 
-    /**
-     * If all files of a container were processed, notify the container
-     * about this and set the updating signal.
-     * Reschedule the iteration and extraction
-     */
-    private void do_update () {
-        if (this.files.is_empty &&
-            !this.containers.is_empty ()) {
-            this.containers.pop_head ();
+    private void remove_basic_item (FileQueueEntry entry) {
+        try {
+            var object = this.cache.get_object (entry.id);
+            if (object != null) {
+                var container = entry.parent as TrackableContainer;
+                container.remove_child_tracked.begin (object);
+            }
+        } catch (Error error) {
+            warning (_("Error removing object from database: %s"),
+                     error.message);
         }
-
-        this.on_idle ();
     }
 }
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Database rows of recently used items.
+ *
+ * Clients look up the item they stream for every HTTP request, often several
+ * times per second. Keeping the rows the item and its parents are built from
+ * saves the query and the round trip to a database thread every time.
+ *
+ * Only the rows are shared, which cannot be changed. Callers change the
+ * objects they get, for example when adding resources for the client or
+ * applying its hacks, so each of them gets objects of its own.
+ *
+ * Containers are not kept, as their child count changes with every object
+ * added below them.
+ *
+ * The rows of an item's parents are kept along with it, so the parents built
+ * from them carry the update ids and deleted child count of the time the
+ * item was read. Only the item itself is up to date; the child count of a
+ * DBContainer is counted again whenever one is built.
+ */
+internal class Rygel.MediaExport.ItemCache : Object {
+    private const int MAX_ENTRIES = 256;
+
+    private LruCache<string, Gee.List<Database.Row>> entries;
+
+    public ItemCache () {
+        this.entries = new LruCache<string, Gee.List<Database.Row>>
+                                        (MAX_ENTRIES);
+    }
+
+    /**
+     * Get the rows of the item with @id if they are known.
+     *
+     * @return the rows of the item and its parents as read with the
+     * GET_OBJECT query, or null if they are not cached
+     */
+    public Gee.List<Database.Row>? lookup (string id) {
+        return this.entries[id];
+    }
+
+    public void store (string id, Gee.List<Database.Row> rows) {
+        this.entries[id] = rows;
+    }
+
+    /**
+     * Forget the item with @id, because it was changed or removed.
+     */
+    public void invalidate (string id) {
+        this.entries.unset (id);
+    }
+
+    public void clear () {
+        this.entries.clear ();
+    }
+}
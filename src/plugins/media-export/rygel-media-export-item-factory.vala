@@ -97,6 +97,62 @@ namespace Rygel.MediaExport.ItemFactory {
     }
 
 
+    /**
+     * Create a basic item from the information the harvester already has
+     * after enumerating a directory, without looking into the file.
+     *
+     * The item's timestamp is left at 0 so the file is re-visited on the next
+     * scan if the deep meta-data extraction did not finish before.
+     *
+     * @return the new item or null if the content type has no basic mapping
+     */
+    static MediaObject? create_from_info (MediaContainer parent,
+                                          File           file,
+                                          FileInfo       info)
+                                          throws Error {
+        var info_type = info.get_content_type ();
+        if (info_type == null) {
+            return null;
+        }
+
+        var content_type = ContentType.get_mime_type (info_type);
+        if (content_type == null) {
+            return null;
+        }
+
+        string upnp_class = null;
+
+        if (content_type.has_prefix ("video/")) {
+            upnp_class = Rygel.VideoItem.UPNP_CLASS;
+        } else if (content_type.has_prefix ("image/")) {
+            upnp_class = Rygel.PhotoItem.UPNP_CLASS;
+        } else if (content_type.has_prefix ("audio/") ||
+                   content_type == "application/ogg") {
+            upnp_class = Rygel.MusicItem.UPNP_CLASS;
+        } else {
+            // Playlists and disc images need to be parsed to know what they
+            // are
+            return null;
+        }
+
+        var vd = new VariantDict ();
+        var mtime = info.get_attribute_uint64 (FileAttribute.TIME_MODIFIED);
+        var date = new DateTime.from_unix_utc ((int64) mtime);
+
+        vd.insert (Serializer.UPNP_CLASS, "s", upnp_class);
+        vd.insert (Serializer.ID, "s", MediaCache.get_id (file));
+        vd.insert (Serializer.URI, "s", file.get_uri ());
+        vd.insert (Serializer.TITLE, "s", info.get_display_name ());
+        vd.insert (Serializer.DATE,
+                   "s",
+                   GUPnP.format_date_time_for_didl_lite (date));
+        vd.insert (Serializer.MODIFIED, "t", (uint64) 0);
+        vd.insert (Serializer.MIME_TYPE, "s", content_type);
+        vd.insert (Serializer.SIZE, "t", info.get_size ());
+
+        return create_from_variant (parent, file, vd.end ());
+    }
+
     static MediaObject? create_from_variant (MediaContainer parent,
                                              File           file,
                                              Variant?       v)
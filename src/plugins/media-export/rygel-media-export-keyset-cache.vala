@@ -0,0 +1,251 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+using Sqlite;
+
+/**
+ * Remember where the last page of a sorted query ended.
+ *
+ * Clients usually page sequentially through Browse and Search results. Using
+ * OFFSET for this makes SQLite step over all previous rows for every page.
+ * Instead, the sort key of the last row of a page is kept, so the query for
+ * the next page can continue right after it.
+ */
+internal class Rygel.MediaExport.KeysetCache : Object {
+    private const int MAX_ENTRIES = 32;
+
+    private class Entry {
+        public long next_offset;
+        public GLib.Value[] last_key;
+    }
+
+    private HashMap<string, Entry> entries;
+
+    public KeysetCache () {
+        this.entries = new HashMap<string, Entry> ();
+    }
+
+    /**
+     * Create the key identifying a query independent of its paging.
+     *
+     * @param query the SQL query, including sorting
+     * @param args values bound to the query, without offset and limit
+     * @param update_id update id of the data the query runs on
+     */
+    public static string make_key (string                 query,
+                                   GLib.Array<GLib.Value> args,
+                                   uint32                 update_id) {
+        var builder = new StringBuilder (query);
+        builder.append_printf ("\n%u", update_id);
+        for (var i = 0; i < args.length; i++) {
+            builder.append_c ('\n');
+            builder.append (args.index (i).strdup_contents ());
+        }
+
+        return builder.str;
+    }
+
+    /**
+     * Get the sort key of the row before @offset.
+     *
+     * @return the sort key or null if the previous page ending at @offset is
+     * not known
+     */
+    public GLib.Value[]? lookup (string key, long offset) {
+        if (offset == 0) {
+            return null;
+        }
+
+        var entry = this.entries[key];
+        if (entry == null || entry.next_offset != offset) {
+            return null;
+        }
+
+        return entry.last_key;
+    }
+
+    /**
+     * Remember the sort key of the last row of a page
+     *
+     * @param key the query, as returned by make_key ()
+     * @param next_offset the offset of the row following the page
+     * @param last_key the sort columns of the last row of the page
+     */
+    public void store (string key, long next_offset, GLib.Value[] last_key) {
+        if (this.entries.size >= MAX_ENTRIES && !this.entries.has_key (key)) {
+            this.entries.clear ();
+        }
+
+        var entry = new Entry ();
+        entry.next_offset = next_offset;
+        entry.last_key = last_key;
+        this.entries[key] = entry;
+    }
+
+    /**
+     * Read the sort key of a row.
+     *
+     * @param row the result row
+     * @param first_column the index of the first sort column in the result
+     * @param count the number of sort columns
+     * @return the sort key or null if one of the columns has an unsupported
+     * type
+     */
+    public static GLib.Value[]? read_key (Database.Row row,
+                                          int          first_column,
+                                          int          count) {
+        var key = new GLib.Value[count];
+
+        for (var i = 0; i < count; i++) {
+            var column = first_column + i;
+            switch (row.column_type (column)) {
+                case Sqlite.INTEGER:
+                    key[i] = row.column_int64 (column);
+                    break;
+                case Sqlite.TEXT:
+                    key[i] = row.column_text (column);
+                    break;
+                case Sqlite.NULL:
+                    key[i] = Database.@null ();
+                    break;
+                default:
+                    return null;
+            }
+        }
+
+        return key;
+    }
+
+    /**
+     * Build the condition selecting all rows sorted after @last_key.
+     *
+     * NULL sorts before any other value in SQLite, which is taken into
+     * account for both sort directions.
+     *
+     * @param columns the sort columns
+     * @param descending the sort direction of each column
+     * @param last_key the sort key of the last row already returned
+     * @param args array to append the values to bind to
+     * @return the SQL condition
+     */
+    public static string make_condition (string[]               columns,
+                                         bool[]                 descending,
+                                         GLib.Value[]           last_key,
+                                         GLib.Array<GLib.Value> args) {
+        var builder = new StringBuilder ("(");
+
+        for (var i = 0; i < columns.length; i++) {
+            if (i > 0) {
+                builder.append (" OR ");
+            }
+
+            builder.append ("(");
+            for (var j = 0; j < i; j++) {
+                builder.append_printf ("%s IS ? AND ", columns[j]);
+                args.append_val (last_key[j]);
+            }
+
+            var is_null = last_key[i].holds (typeof (void *));
+            if (!descending[i]) {
+                if (is_null) {
+                    builder.append_printf ("%s IS NOT NULL", columns[i]);
+                } else {
+                    builder.append_printf ("%s > ?", columns[i]);
+                    args.append_val (last_key[i]);
+                }
+            } else {
+                if (is_null) {
+                    builder.append ("0");
+                } else {
+                    builder.append_printf ("(%s < ? OR %s IS NULL)",
+                                           columns[i],
+                                           columns[i]);
+                    args.append_val (last_key[i]);
+                }
+            }
+            builder.append (")");
+        }
+        builder.append (")");
+
+        return builder.str;
+    }
+}
+
+/**
+ * A page of a sorted query, remembering the sort key of its last row in a
+ * KeysetCache.
+ */
+internal class Rygel.MediaExport.KeysetPage : Object {
+    /// The query for the page
+    public string sql { get; private set; }
+    /// The values to bind to the query
+    public GLib.Value[] args;
+
+    private KeysetCache cache;
+    private string key;
+    private long offset;
+    private long max_count;
+    private int first_key_column;
+    private int key_columns;
+    private long rows;
+    private GLib.Value[]? last_key;
+
+    public KeysetPage (KeysetCache  cache,
+                       string       key,
+                       string       sql,
+                       GLib.Value[] args,
+                       long         offset,
+                       long         max_count,
+                       int          first_key_column,
+                       int          key_columns) {
+        this.cache = cache;
+        this.key = key;
+        this.sql = sql;
+        this.args = args;
+        this.offset = offset;
+        this.max_count = max_count;
+        this.first_key_column = first_key_column;
+        this.key_columns = key_columns;
+    }
+
+    /**
+     * Call for every row of the result.
+     */
+    public void advance (Database.Row row) {
+        this.rows++;
+
+        // Only a full page can be followed by another one
+        if (this.rows == this.max_count) {
+            this.last_key = KeysetCache.read_key (row,
+                                                  this.first_key_column,
+                                                  this.key_columns);
+        }
+    }
+
+    /**
+     * Call after all rows of the result were read.
+     */
+    public void done () {
+        if (this.last_key != null) {
+            this.cache.store (this.key,
+                              this.offset + this.max_count,
+                              this.last_key);
+        }
+    }
+}
@@ -60,7 +60,13 @@ internal class Rygel.MediaExport.MediaCacheUpgrader {
                 database.exec ("DELETE FROM Object WHERE upnp_id IN (" +
                                "SELECT DISTINCT object_fk FROM meta_data)");
                 database.exec ("DROP TABLE Meta_Data");
+                // Dropping meta_data also dropped some of the triggers
+                // maintaining the full-text index, drop the rest and let
+                // ensure_full_text_index () rebuild it
+                database.exec (this.sql.make (SQLString.DROP_FULL_TEXT_INDEX));
                 database.exec (this.sql.make (SQLString.TABLE_METADATA));
+                database.exec ("DELETE FROM meta_data_aggregate");
+                database.exec (this.sql.make (SQLString.TRIGGER_AGGREGATE));
                 database.commit ();
             } catch (Error error) {
                 database.rollback ();
@@ -80,6 +86,128 @@ internal class Rygel.MediaExport.MediaCacheUpgrader {
         }
     }
 
+    /**
+     * Create and fill the full-text index for contains searches if it does
+     * not exist yet.
+     *
+     * The index needs SQLite's FTS5 with the trigram tokenizer; if that is
+     * not available, searches keep using the slower contains() function.
+     *
+     * @return true if the full-text index is available, false otherwise
+     */
+    public bool ensure_full_text_index () {
+        try {
+            var sql = this.sql.make (SQLString.HAS_FULL_TEXT_INDEX);
+            if (this.database.query_value (sql) == 2) {
+                return true;
+            }
+        } catch (Error error) {
+            warning (_("Failed to query full-text index: %s"), error.message);
+
+            return false;
+        }
+
+        try {
+            debug ("Creating full-text index…");
+            this.database.begin ();
+            this.database.exec (this.sql.make (SQLString.DROP_FULL_TEXT_INDEX));
+            this.database.exec (this.sql.make (SQLString.TABLE_FULL_TEXT_INDEX));
+            this.database.exec (this.sql.make (SQLString.TRIGGER_FULL_TEXT_INDEX));
+            this.database.exec (this.sql.make (SQLString.FILL_FULL_TEXT_INDEX));
+            this.database.commit ();
+
+            return true;
+        } catch (Error error) {
+            this.database.rollback ();
+            message ("Full-text index not available, searches for " +
+                     "substrings will be slow: %s",
+                     error.message);
+        }
+
+        return false;
+    }
+
+    /**
+     * Make sure the stored collation keys match the collation of the current
+     * locale.
+     */
+    public void ensure_collation_keys () {
+        var collation = Intl.setlocale (LocaleCategory.COLLATE, null) ?? "C";
+
+        try {
+            var cursor = this.database.exec_cursor
+                                        (this.sql.make (SQLString.GET_COLLATION));
+            var statement = cursor.next ();
+            if (statement->column_text (0) == collation) {
+                return;
+            }
+        } catch (Error error) {
+            warning (_("Failed to query collation: %s"), error.message);
+
+            return;
+        }
+
+        try {
+            debug ("Computing collation keys for locale %s…", collation);
+            GLib.Value[] args = { collation };
+            this.database.begin ();
+            this.database.exec (this.sql.make (SQLString.UPDATE_COLLATION_KEYS));
+            this.database.exec (this.sql.make (SQLString.SET_COLLATION), args);
+            this.database.commit ();
+        } catch (Error error) {
+            this.database.rollback ();
+            warning (_("Failed to update collation keys: %s"), error.message);
+        }
+    }
+
+    /**
+     * Convert the database to the @requested hierarchy if it uses another
+     * one.
+     *
+     * Afterwards, the SQL factory is set up for the hierarchy the database
+     * uses.
+     */
+    public void ensure_hierarchy (Hierarchy requested) {
+        Hierarchy current;
+
+        try {
+            var cursor = this.database.exec_cursor
+                                        (this.sql.make (SQLString.GET_HIERARCHY));
+            var statement = cursor.next ();
+            current = Hierarchy.from_name (statement->column_text (0));
+        } catch (Error error) {
+            warning (_("Failed to query hierarchy: %s"), error.message);
+
+            return;
+        }
+
+        this.sql.hierarchy = current;
+        if (current == requested) {
+            return;
+        }
+
+        try {
+            message ("Converting %s hierarchy to %s…",
+                     current.get_name (),
+                     requested.get_name ());
+            GLib.Value[] args = { requested.get_name () };
+            this.database.begin ();
+            this.database.exec (this.sql.make (SQLString.DROP_HIERARCHY));
+            this.sql.hierarchy = requested;
+            this.database.exec (this.sql.make (SQLString.TABLE_HIERARCHY));
+            this.database.exec (this.sql.make (SQLString.FILL_HIERARCHY));
+            this.database.exec (this.sql.make (SQLString.INDEX_COMMON));
+            this.database.exec (this.sql.make (SQLString.TRIGGER_HIERARCHY));
+            this.database.exec (this.sql.make (SQLString.SET_HIERARCHY), args);
+            this.database.commit ();
+            this.database.exec ("VACUUM");
+        } catch (Error error) {
+            this.database.rollback ();
+            this.sql.hierarchy = current;
+            warning (_("Failed to convert hierarchy: %s"), error.message);
+        }
+    }
+
     public void upgrade (int old_version) throws MediaCacheError {
         debug ("Older schema detected. Upgrading...");
         int current_version = int.parse (SQLFactory.SCHEMA_VERSION);
@@ -93,6 +221,24 @@ internal class Rygel.MediaExport.MediaCacheUpgrader {
                 case 17:
                     this.update_v17_v18 (true);
                     break;
+                case 18:
+                    this.update_v18_v19 ();
+                    break;
+                case 19:
+                    this.update_v19_v20 ();
+                    break;
+                case 20:
+                    this.update_v20_v21 ();
+                    break;
+                case 21:
+                    this.update_v21_v22 ();
+                    break;
+                case 22:
+                    this.update_v22_v23 ();
+                    break;
+                case 23:
+                    this.update_v23_v24 ();
+                    break;
                 default:
                     throw new MediaCacheError.UPGRADE_FAILED (_("Cannot upgrade from version %d"), old_version);
             }
@@ -117,4 +263,90 @@ internal class Rygel.MediaExport.MediaCacheUpgrader {
             throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v18 failed: %s"), error.message);
         }
     }
+
+    private void update_v18_v19 () throws MediaCacheError {
+        try {
+            this.database.begin ();
+            this.database.exec (this.sql.make (SQLString.TABLE_FILE_IDENTITY));
+            this.database.exec (this.sql.make (SQLString.TRIGGER_FILE_IDENTITY));
+            database.exec ("UPDATE schema_info SET VERSION = '19'");
+            this.database.commit ();
+        } catch (Database.DatabaseError error) {
+            database.rollback ();
+            throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v19 failed: %s"), error.message);
+        }
+    }
+
+    private void update_v19_v20 () throws MediaCacheError {
+        // The full-text index is optional, failing to create it should not
+        // stop the upgrade
+        this.ensure_full_text_index ();
+
+        try {
+            database.exec ("UPDATE schema_info SET VERSION = '20'");
+        } catch (Database.DatabaseError error) {
+            throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v20 failed: %s"), error.message);
+        }
+    }
+
+    private void update_v20_v21 () throws MediaCacheError {
+        // The keys are computed by ensure_collation_keys ()
+        try {
+            this.database.begin ();
+            database.exec ("ALTER TABLE schema_info ADD collation TEXT");
+            database.exec ("ALTER TABLE Object ADD title_key TEXT");
+            database.exec ("ALTER TABLE meta_data ADD author_key TEXT");
+            database.exec ("ALTER TABLE meta_data ADD album_key TEXT");
+            database.exec ("ALTER TABLE meta_data ADD genre_key TEXT");
+            database.exec ("ALTER TABLE meta_data ADD creator_key TEXT");
+            database.exec ("UPDATE schema_info SET VERSION = '21'");
+            this.database.commit ();
+        } catch (Database.DatabaseError error) {
+            database.rollback ();
+            throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v21 failed: %s"), error.message);
+        }
+    }
+
+    private void update_v21_v22 () throws MediaCacheError {
+        // The value keys are copied from meta_data, ensure_collation_keys ()
+        // recomputes them if they are missing or outdated
+        try {
+            this.database.begin ();
+            this.database.exec (this.sql.make (SQLString.TABLE_AGGREGATE));
+            this.database.exec (this.sql.make (SQLString.TRIGGER_AGGREGATE));
+            this.database.exec (this.sql.make (SQLString.FILL_AGGREGATE));
+            database.exec ("UPDATE schema_info SET VERSION = '22'");
+            this.database.commit ();
+        } catch (Database.DatabaseError error) {
+            database.rollback ();
+            throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v22 failed: %s"), error.message);
+        }
+    }
+
+    private void update_v22_v23 () throws MediaCacheError {
+        // Existing databases keep the closure table until
+        // ensure_hierarchy () is asked for another hierarchy
+        try {
+            this.database.begin ();
+            database.exec ("ALTER TABLE schema_info ADD hierarchy TEXT");
+            database.exec ("UPDATE schema_info SET hierarchy = 'closure'");
+            database.exec ("UPDATE schema_info SET VERSION = '23'");
+            this.database.commit ();
+        } catch (Database.DatabaseError error) {
+            database.rollback ();
+            throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v23 failed: %s"), error.message);
+        }
+    }
+
+    private void update_v23_v24 () throws MediaCacheError {
+        try {
+            this.database.begin ();
+            database.exec (this.sql.make (SQLString.TABLE_SIDECAR));
+            database.exec ("UPDATE schema_info SET VERSION = '24'");
+            this.database.commit ();
+        } catch (Database.DatabaseError error) {
+            database.rollback ();
+            throw new MediaCacheError.UPGRADE_FAILED (_("Database upgrade to v24 failed: %s"), error.message);
+        }
+    }
 }
@@ -46,6 +46,7 @@ internal struct Rygel.MediaExport.ExistsCacheEntry {
     int64 mtime;
     int64 size;
     string content_type;
+    bool has_identity;
 }
 
 /**
@@ -59,6 +60,17 @@ public class Rygel.MediaExport.MediaCache : Object {
     private ObjectFactory                      factory;
     private SQLFactory                         sql;
     private HashMap<string, ExistsCacheEntry?> exists_cache;
+    private bool                               full_text_index;
+    private KeysetCache                        keysets;
+    // Changes whenever objects are added or removed
+    private uint32                             generation;
+    private HashMap<string, uint>              match_counts;
+    private ItemCache                          items;
+    private QueryPlanCache                     plans;
+
+    private const int MAX_MATCH_COUNTS = 64;
+    // Upper limit of worker threads reading the database
+    private const uint MAX_READERS = 4;
 
     // Private static members
     private static MediaCache instance;
@@ -72,9 +84,36 @@ public class Rygel.MediaExport.MediaCache : Object {
                 db_name = ":memory:";
             }
         } catch (Error error) { }
+
+        var hierarchy = Hierarchy.CLOSURE;
+        try {
+            var config = MetaConfig.get_default ();
+            hierarchy = Hierarchy.from_name (config.get_string ("MediaExport",
+                                                                "hierarchy"));
+        } catch (Error error) { }
+
+        Database.Profile profile = null;
+        try {
+            var config = MetaConfig.get_default ();
+            if (config.get_bool ("MediaExport", "profile-queries")) {
+                profile = new Database.Profile ();
+            }
+        } catch (Error error) { }
+
         this.sql = new SQLFactory ();
-        this.open_db (db_name);
+        if (profile != null) {
+            this.sql.label_queries ();
+            Statistics.get_default ().register ("media-export-queries",
+                                                profile);
+        }
+        this.keysets = new KeysetCache ();
+        this.match_counts = new HashMap<string, uint> ();
+        this.items = new ItemCache ();
+        this.plans = new QueryPlanCache ();
+        this.open_db (db_name, hierarchy, profile);
         this.factory = new ObjectFactory ();
+        SidecarCache.get_default ().store = new SidecarTable (this.db,
+                                                              this.sql);
     }
 
     // Public static functions
@@ -97,6 +136,10 @@ public class Rygel.MediaExport.MediaCache : Object {
     public void remove_by_id (string id) throws DatabaseError {
         GLib.Value[] values = { id };
         this.db.exec (this.sql.make (SQLString.DELETE), values);
+        this.generation++;
+
+        // Removing a container removes everything below it
+        this.items.clear ();
     }
 
     public void remove_object (MediaObject object) throws DatabaseError,
@@ -114,6 +157,7 @@ public class Rygel.MediaExport.MediaCache : Object {
             this.save_container_metadata (container);
             this.create_object (container);
             db.commit ();
+            this.generation++;
         } catch (DatabaseError error) {
             db.rollback ();
 
@@ -131,6 +175,8 @@ public class Rygel.MediaExport.MediaCache : Object {
             this.save_item_metadata (item);
             this.create_object (item, override_guarded);
             db.commit ();
+            this.generation++;
+            this.items.invalidate (item.id);
         } catch (DatabaseError error) {
             warning (_("Failed to add item with ID %s: %s"),
                      item.id,
@@ -148,22 +194,79 @@ public class Rygel.MediaExport.MediaCache : Object {
      * after serializing the result.
      */
     public MediaObject? get_object (string object_id) throws DatabaseError {
-        GLib.Value[] values = { object_id };
         MediaObject parent = null;
 
-        var cursor = this.exec_cursor (SQLString.GET_OBJECT, values);
+        var cursor = this.db.prepare (this.sql.make (SQLString.GET_OBJECT));
+        cursor.bind_text (1, object_id);
 
         foreach (var statement in cursor) {
-            var parent_container = parent as MediaContainer;
-            var object = this.get_object_from_statement (parent_container,
-                                                         statement);
-            object.parent_ref = parent_container;
-            parent = object;
+            parent = this.get_object_with_parent
+                                        (parent,
+                                         new Database.StatementRow (statement));
         }
 
         return parent;
     }
 
+    /**
+     * Like get_object (), but reading the database on a worker thread.
+     */
+    public async MediaObject? get_object_async (string       object_id,
+                                                Cancellable? cancellable = null)
+                                                throws Error {
+        GLib.Value[] values = { object_id };
+        MediaObject parent = null;
+
+        var rows = yield this.read_rows (this.sql.make (SQLString.GET_OBJECT),
+                                         values,
+                                         cancellable);
+
+        foreach (var row in rows) {
+            parent = this.get_object_with_parent (parent, row);
+        }
+
+        return parent;
+    }
+
+    /**
+     * Like get_object_async (), but the rows of recently used items are kept
+     * in memory, so they are usually built without a query.
+     *
+     * Every call returns objects of its own, which the caller may change.
+     *
+     * The parents of a cached item may have outdated update ids and deleted
+     * child counts, see ItemCache.
+     */
+    public async MediaObject? get_cached_object
+                                        (string       object_id,
+                                         Cancellable? cancellable = null)
+                                         throws Error {
+        var rows = this.items.lookup (object_id);
+        var cached = rows != null;
+
+        // Do not keep an item that was changed while reading it
+        var generation = this.generation;
+        if (!cached) {
+            GLib.Value[] values = { object_id };
+            rows = yield this.read_rows (this.sql.make (SQLString.GET_OBJECT),
+                                         values,
+                                         cancellable);
+        }
+
+        MediaObject object = null;
+        foreach (var row in rows) {
+            object = this.get_object_with_parent (object, row);
+        }
+
+        if (!cached &&
+            object is MediaFileItem &&
+            generation == this.generation) {
+            this.items.store (object_id, rows);
+        }
+
+        return object;
+    }
+
     public MediaContainer? get_container (string container_id)
                                           throws DatabaseError,
                                                  MediaCacheError {
@@ -222,9 +325,9 @@ public class Rygel.MediaExport.MediaCache : Object {
     public bool exists (File      file,
                         out int64 timestamp,
                         out int64 size,
-                        out string mime_type) throws DatabaseError {
+                        out string mime_type,
+                        out bool has_identity = null) throws DatabaseError {
         var uri = file.get_uri ();
-        GLib.Value[] values = { uri };
         mime_type = null;
 
         if (this.exists_cache.has_key (uri)) {
@@ -233,11 +336,13 @@ public class Rygel.MediaExport.MediaCache : Object {
             timestamp = entry.mtime;
             size = entry.size;
             mime_type = entry.content_type;
+            has_identity = entry.has_identity;
 
             return true;
         }
 
-        var cursor = this.exec_cursor (SQLString.EXISTS, values);
+        var cursor = this.db.prepare (this.sql.make (SQLString.EXISTS));
+        cursor.bind_text (1, uri);
         var statement = cursor.next ();
         timestamp = statement->column_int64 (1);
 
@@ -246,44 +351,118 @@ public class Rygel.MediaExport.MediaCache : Object {
             timestamp = 0;
         }
         size = statement->column_int64 (2);
+        has_identity = statement->column_type (3) != Sqlite.NULL;
 
         return statement->column_int (0) == 1;
     }
 
-    public MediaObjects get_children (MediaContainer container,
-                                      string         sort_criteria,
-                                      long           offset,
-                                      long           max_count)
-                                      throws Error {
-        MediaObjects children = new MediaObjects ();
+    /**
+     * Remember the file system identity of a harvested file.
+     *
+     * @param file the file
+     * @param info FileInfo of the file, containing at least size, mtime and
+     *             the unix device and inode attributes
+     */
+    public void save_file_identity (File file, FileInfo info) {
+        var inode = info.get_attribute_uint64 (FileAttribute.UNIX_INODE);
 
-        GLib.Value[] values = { container.id,
-                                offset,
-                                max_count };
+        // Not on a file system with inodes, nothing to identify the file by
+        if (inode == 0) {
+            return;
+        }
 
-        var sql = this.sql.make (SQLString.GET_CHILDREN);
-        var sort_order = MediaCache.translate_sort_criteria (sort_criteria);
-        var cursor = this.db.exec_cursor (sql.printf (sort_order), values);
+        try {
+            GLib.Value[] values = {
+                file.get_uri (),
+                (int64) info.get_attribute_uint32 (FileAttribute.UNIX_DEVICE),
+                (int64) inode,
+                info.get_size (),
+                (int64) info.get_attribute_uint64 (FileAttribute.TIME_MODIFIED)
+            };
+
+            this.db.exec (this.sql.make (SQLString.SAVE_FILE_IDENTITY),
+                          values);
+        } catch (DatabaseError error) {
+            warning (_("Failed to save file identity of %s: %s"),
+                     file.get_uri (),
+                     error.message);
+        }
+    }
 
+    /**
+     * Find a cached file with the same device, inode, size and mtime as
+     * @file, but a different URI.
+     *
+     * @param file the file that is new to the cache
+     * @param info FileInfo of the file, see save_file_identity ()
+     * @return the URI the file was known under before, or null
+     */
+    public string? find_moved_file (File file, FileInfo info)
+                                    throws DatabaseError {
+        var inode = info.get_attribute_uint64 (FileAttribute.UNIX_INODE);
+        if (inode == 0) {
+            return null;
+        }
+
+        GLib.Value[] values = {
+            (int64) inode,
+            (int64) info.get_attribute_uint32 (FileAttribute.UNIX_DEVICE),
+            info.get_size (),
+            (int64) info.get_attribute_uint64 (FileAttribute.TIME_MODIFIED),
+            file.get_uri ()
+        };
+
+        var cursor = this.exec_cursor (SQLString.FIND_BY_FILE_IDENTITY,
+                                       values);
         foreach (var statement in cursor) {
-            children.add (this.get_object_from_statement (container,
-                                                          statement));
+            return statement.column_text (0);
+        }
+
+        return null;
+    }
+
+    public async MediaObjects get_children (MediaContainer container,
+                                            string         sort_criteria,
+                                            long           offset,
+                                            long           max_count,
+                                            Cancellable?   cancellable = null)
+                                            throws Error {
+        MediaObjects children = new MediaObjects ();
+        var args = new GLib.Array<GLib.Value> ();
+        GLib.Value v = container.id;
+        args.append_val (v);
+
+        var page = this.prepare_page (this.sql.make (SQLString.GET_CHILDREN),
+                                      "",
+                                      "AND",
+                                      sort_criteria,
+                                      args,
+                                      container.update_id,
+                                      offset,
+                                      max_count);
+
+        var rows = yield this.read_rows (page.sql, page.args, cancellable);
+        foreach (var row in rows) {
+            children.add (this.get_object_from_row (container, row));
             children.last ().parent_ref = container;
+            page.advance (row);
         }
+        page.done ();
 
         return children;
     }
 
-    public MediaObjects get_objects_by_search_expression
+    public async MediaObjects get_objects_by_search_expression
                                         (SearchExpression? expression,
                                          string?           container_id,
                                          string            sort_criteria,
                                          uint              offset,
                                          uint              max_count,
+                                         Cancellable?      cancellable,
                                          out uint          total_matches)
                                          throws Error {
         var args = new GLib.Array<GLib.Value> ();
-        var filter = MediaCache.translate_search_expression (expression, args);
+        var filter = this.translate_search_expression (expression, args);
 
         if (expression != null) {
             debug ("Original search: %s", expression.to_string ());
@@ -291,16 +470,39 @@ public class Rygel.MediaExport.MediaCache : Object {
         }
 
         var max_objects = modify_limit (max_count);
-        total_matches = (uint) get_object_count_by_filter (filter,
-                                                           args,
-                                                           container_id);
+        if (container_id != null) {
+            GLib.Value v = container_id;
+            args.prepend_val (v);
+        }
+        var filter_arg_count = args.length;
+
+        var children = yield this.get_objects_by_filter (filter,
+                                                         args,
+                                                         container_id,
+                                                         sort_criteria,
+                                                         offset,
+                                                         max_objects,
+                                                         cancellable);
+
+        // Drop the paging arguments again for counting
+        args.remove_range (filter_arg_count, args.length - filter_arg_count);
+
+        // A page that is not full is the last one, so it already tells the
+        // total number of matches
+        if ((uint) children.size < max_objects &&
+            (children.size > 0 || offset == 0)) {
+            total_matches = offset + children.size;
+            var key = KeysetCache.make_key (filter, args, this.generation);
+            this.remember_match_count (key, total_matches);
+        } else {
+            var count = yield this.count_matches_async (filter,
+                                                        args,
+                                                        container_id,
+                                                        cancellable);
+            total_matches = (uint) count;
+        }
 
-        return this.get_objects_by_filter (filter,
-                                           args,
-                                           container_id,
-                                           sort_criteria,
-                                           offset,
-                                           max_objects);
+        return children;
     }
 
     public long get_object_count_by_search_expression
@@ -308,7 +510,7 @@ public class Rygel.MediaExport.MediaCache : Object {
                                          string?           container_id)
                                          throws Error {
         var args = new GLib.Array<GLib.Value> ();
-        var filter = MediaCache.translate_search_expression (expression, args);
+        var filter = this.translate_search_expression (expression, args);
 
         if (expression != null) {
             debug ("Original search: %s", expression.to_string ());
@@ -337,41 +539,92 @@ public class Rygel.MediaExport.MediaCache : Object {
             args.prepend_val (v);
         }
 
+        return this.count_matches (filter, args, container_id);
+    }
+
+    /**
+     * Count the objects matching @filter.
+     *
+     * Clients re-issue the same search for every page they fetch, so the
+     * result is kept until the next modification of the cache.
+     *
+     * @param args values to bind, including the container id if
+     * @container_id is not null
+     */
+    private long count_matches (string                 filter,
+                                GLib.Array<GLib.Value> args,
+                                string?                container_id)
+                                throws Error {
+        var key = KeysetCache.make_key (filter, args, this.generation);
+        if (this.match_counts.has_key (key)) {
+            return this.match_counts[key];
+        }
+
         debug ("Parameters to bind: %u", args.length);
-        unowned string pattern;
+        var sql = this.get_count_sql (filter, container_id);
+
+        var count = this.db.query_value (sql, args.data);
+        this.remember_match_count (key, count);
+
+        return count;
+    }
+
+    /**
+     * Like count_matches (), but counting on a worker thread.
+     */
+    private async long count_matches_async (string                 filter,
+                                            GLib.Array<GLib.Value> args,
+                                            string?                container_id,
+                                            Cancellable?           cancellable)
+                                            throws Error {
+        var key = KeysetCache.make_key (filter, args, this.generation);
+        if (this.match_counts.has_key (key)) {
+            return this.match_counts[key];
+        }
+
+        var sql = this.get_count_sql (filter, container_id);
+        GLib.Value[] values = args.data;
+        var count = 0;
+
+        yield this.db.read ((connection) => {
+            count = connection.query_value (sql, values);
+        }, cancellable);
+        this.remember_match_count (key, count);
+
+        return count;
+    }
+
+    private string get_count_sql (string filter, string? container_id) {
         SQLString string_id;
         if (container_id != null) {
             string_id = SQLString.GET_OBJECT_COUNT_BY_FILTER_WITH_ANCESTOR;
         } else {
             string_id = SQLString.GET_OBJECT_COUNT_BY_FILTER;
         }
-        pattern = this.sql.make (string_id);
 
-        return this.db.query_value (pattern.printf (filter), args.data);
+        return this.sql.make (string_id).printf (filter);
+    }
+
+    private void remember_match_count (string key, uint count) {
+        if (this.match_counts.size >= MAX_MATCH_COUNTS) {
+            this.match_counts.clear ();
+        }
+
+        this.match_counts[key] = count;
     }
 
-    public MediaObjects get_objects_by_filter (string          filter,
-                                               GLib.Array<GLib.Value> args,
-                                               string?         container_id,
-                                               string          sort_criteria,
-                                               long            offset,
-                                               long            max_count)
-                                               throws Error {
+    public async MediaObjects get_objects_by_filter
+                                        (string                 filter,
+                                         GLib.Array<GLib.Value> args,
+                                         string?                container_id,
+                                         string                 sort_criteria,
+                                         long                   offset,
+                                         long                   max_count,
+                                         Cancellable?           cancellable)
+                                         throws Error {
         var children = new MediaObjects ();
-        GLib.Value v = offset;
-        args.append_val (v);
-        v = max_count;
-        args.append_val (v);
         MediaContainer parent = null;
 
-        debug ("Parameters to bind: %u", args.length);
-        for (int i = 0; i < args.length; i++) {
-            var arg = args.index (i);
-            debug ("Arg %d: %s", i, arg.holds (typeof (string)) ?
-                                        arg.get_string () :
-                                        arg.strdup_contents ());
-        }
-
         unowned string sql;
         if (container_id != null) {
             sql = this.sql.make (SQLString.GET_OBJECTS_BY_FILTER_WITH_ANCESTOR);
@@ -379,11 +632,18 @@ public class Rygel.MediaExport.MediaCache : Object {
             sql = this.sql.make (SQLString.GET_OBJECTS_BY_FILTER);
         }
 
-        var sort_order = MediaCache.translate_sort_criteria (sort_criteria);
-        var cursor = this.db.exec_cursor (sql.printf (filter, sort_order),
-                                          args.data);
-        foreach (var statement in cursor) {
-            unowned string parent_id = statement.column_text (DetailColumn.PARENT);
+        var page = this.prepare_page (sql,
+                                      filter,
+                                      filter == "" ? "WHERE" : "AND",
+                                      sort_criteria,
+                                      args,
+                                      this.generation,
+                                      offset,
+                                      max_count);
+
+        var rows = yield this.read_rows (page.sql, page.args, cancellable);
+        foreach (var row in rows) {
+            unowned string parent_id = row.column_text (DetailColumn.PARENT);
 
             if (parent == null || parent_id != parent.id) {
                 if (parent_id == null) {
@@ -394,15 +654,16 @@ public class Rygel.MediaExport.MediaCache : Object {
             }
 
             if (parent != null) {
-                children.add (this.get_object_from_statement (parent,
-                                                              statement));
+                children.add (this.get_object_from_row (parent, row));
                 children.last ().parent_ref = parent;
             } else {
                 warning (_("Inconsistent database: item %s does not have parent %s"),
-                         statement.column_text (DetailColumn.ID),
+                         row.column_text (DetailColumn.ID),
                          parent_id);
             }
+            page.advance (row);
         }
+        page.done ();
 
         return children;
     }
@@ -419,6 +680,10 @@ public class Rygel.MediaExport.MediaCache : Object {
         } catch (Error error) {
             debug ("Failed to get database statistics: %s", error.message);
         }
+
+        if (this.db.profile != null) {
+            this.db.profile.dump ();
+        }
     }
 
     public ArrayList<string> get_child_ids (string container_id)
@@ -453,10 +718,13 @@ public class Rygel.MediaExport.MediaCache : Object {
         var builder = new StringBuilder ();
         var data = new ArrayList<string> ();
 
+        // The sort columns need to be part of the result for the UNION below,
+        // so sort on the text columns instead of the collation keys
         var sql_sort_order = MediaCache.translate_sort_criteria
                                         (sort_criteria,
                                          out extra_columns,
-                                         out column_count);
+                                         out column_count,
+                                         false);
 
         // title here is actually the meta-data column, so if we had
         // dc:title in the sort criteria, we need to change this
@@ -497,15 +765,42 @@ public class Rygel.MediaExport.MediaCache : Object {
                                          uint              max_count,
                                          bool              add_all_container)
                                          throws Error {
+        var max_objects = modify_limit (max_count);
+        string aggregate;
+        string upnp_class;
+        string direction;
+
+        if (!add_all_container &&
+            MediaCache.map_to_aggregate (attribute,
+                                         expression,
+                                         out aggregate,
+                                         out upnp_class) &&
+            MediaCache.get_aggregate_sort_order (attribute,
+                                                 sort_criteria,
+                                                 out direction)) {
+            var data = new ArrayList<string> ();
+            GLib.Value[] values = { aggregate,
+                                    upnp_class,
+                                    offset,
+                                    (long) max_objects };
+            var sql = this.sql.make (SQLString.GET_AGGREGATE_VALUES);
+
+            var cursor = this.db.exec_cursor (sql.printf (direction), values);
+            foreach (var statement in cursor) {
+                data.add (statement.column_text (0));
+            }
+
+            return data;
+        }
+
         var args = new Array<GLib.Value> ();
-        var filter = MediaCache.translate_search_expression (expression,
-                                                             args,
-                                                             "AND");
+        var filter = this.translate_search_expression (expression,
+                                                       args,
+                                                       "AND");
 
         debug ("Parsed filter: %s", filter);
 
         var column = MediaCache.map_operand_to_column (attribute);
-        var max_objects = modify_limit (max_count);
 
         return this.get_meta_data_column_by_filter (column,
                                                     filter,
@@ -516,6 +811,39 @@ public class Rygel.MediaExport.MediaCache : Object {
                                                     add_all_container);
     }
 
+    /**
+     * Count the distinct values of @attribute among the objects matching
+     * @expression.
+     */
+    public int get_object_attribute_count_by_search_expression
+                                        (string            attribute,
+                                         SearchExpression? expression,
+                                         bool              add_all_container)
+                                         throws Error {
+        string aggregate;
+        string upnp_class;
+
+        if (!add_all_container &&
+            MediaCache.map_to_aggregate (attribute,
+                                         expression,
+                                         out aggregate,
+                                         out upnp_class)) {
+            GLib.Value[] values = { aggregate, upnp_class };
+
+            return this.query_value (SQLString.GET_AGGREGATE_COUNT, values);
+        }
+
+        var data = this.get_object_attribute_by_search_expression
+                                        (attribute,
+                                         expression,
+                                         "+dc:title",
+                                         0,
+                                         -1,
+                                         add_all_container);
+
+        return data.size;
+    }
+
     public string get_reset_token () {
         try {
             var cursor = this.exec_cursor (SQLString.RESET_TOKEN);
@@ -558,6 +886,7 @@ public class Rygel.MediaExport.MediaCache : Object {
                                     object.id };
 
             this.db.exec (this.sql.make (SQLString.MAKE_GUARDED), values);
+            this.items.invalidate (object.id);
         } catch (DatabaseError error) {
             warning (_("Failed to mark item %s as guarded (%d): %s"),
                      object.id,
@@ -619,10 +948,10 @@ public class Rygel.MediaExport.MediaCache : Object {
     // Private functions
     private bool is_object_guarded (string id) {
         try {
-            GLib.Value[] id_value = { id };
+            var cursor = this.db.prepare (this.sql.make (SQLString.IS_GUARDED));
+            cursor.bind_text (1, id);
 
-            return this.query_value (SQLString.IS_GUARDED,
-                                     id_value) == 1;
+            return cursor.next ()->column_int (0) == 1;
         } catch (DatabaseError error) {
             warning (_("Failed to get whether item %s is guarded: %s"),
                      id,
@@ -640,6 +969,7 @@ public class Rygel.MediaExport.MediaCache : Object {
             entry.mtime = statement.column_int64 (1);
             entry.size = statement.column_int64 (0);
             entry.content_type = statement.column_text (2);
+            entry.has_identity = statement.column_type (4) != Sqlite.NULL;
             this.exists_cache.set (statement.column_text (3), entry);
         }
     }
@@ -652,13 +982,21 @@ public class Rygel.MediaExport.MediaCache : Object {
         }
     }
 
-    private void open_db (string name) throws Error {
-        this.db = new Database.Database (name);
+    private void open_db (string            name,
+                          Hierarchy         hierarchy,
+                          Database.Profile? profile) throws Error {
+        // Write-ahead logging lets the read-only connections of the workers
+        // read while the harvester writes
+        this.db = new Database.Database (name,
+                                         Database.Flavor.CACHE,
+                                         Database.Flags.READ_WRITE |
+                                         Database.Flags.SHARED);
+        this.db.profile = profile;
         int old_version = -1;
         int current_version = int.parse (SQLFactory.SCHEMA_VERSION);
 
+        var upgrader = new MediaCacheUpgrader (this.db, this.sql);
         try {
-            var upgrader = new MediaCacheUpgrader (this.db, this.sql);
             if (upgrader.needs_upgrade (out old_version)) {
                 upgrader.upgrade (old_version);
             } else if (old_version == current_version) {
@@ -672,6 +1010,7 @@ public class Rygel.MediaExport.MediaCache : Object {
                 throw new MediaCacheError.GENERAL_ERROR ("Database format" +
                                                          " not supported");
             }
+            upgrader.ensure_hierarchy (hierarchy);
             upgrader.ensure_indices ();
         } catch (DatabaseError error) {
             debug ("Could not find schema version;" +
@@ -680,6 +1019,7 @@ public class Rygel.MediaExport.MediaCache : Object {
                 if (this.db.is_empty ()) {
                     debug ("Empty database, creating new schema version %s",
                             SQLFactory.SCHEMA_VERSION);
+                    this.sql.hierarchy = hierarchy;
                     if (!create_schema ()) {
                         this.db = null;
 
@@ -699,6 +1039,24 @@ public class Rygel.MediaExport.MediaCache : Object {
                 throw new MediaCacheError.GENERAL_ERROR ("Invalid database");
             }
         }
+
+        upgrader.ensure_collation_keys ();
+        this.full_text_index = upgrader.ensure_full_text_index ();
+
+        try {
+            this.db.exec (this.sql.make (SQLString.PRUNE_AGGREGATE));
+        } catch (Error error) {
+            warning (_("Failed to prune aggregated meta-data: %s"),
+                     error.message);
+        }
+
+        try {
+            this.db.start_readers (uint.min (get_num_processors (),
+                                             MAX_READERS));
+        } catch (Error error) {
+            warning (_("Failed to open read-only database connections: %s"),
+                     error.message);
+        }
     }
 
     private void save_container_metadata (MediaContainer container) throws Error {
@@ -729,63 +1087,61 @@ public class Rygel.MediaExport.MediaCache : Object {
 
 
     private void save_item_metadata (Rygel.MediaFileItem item) throws Error {
-        // Fill common properties
-        GLib.Value[] values = { item.size,
-                                item.mime_type,
-                                -1,
-                                -1,
-                                item.upnp_class,
-                                Database.null (),
-                                Database.null (),
-                                item.date,
-                                -1,
-                                -1,
-                                -1,
-                                -1,
-                                -1,
-                                -1,
-                                -1,
-                                item.id,
-                                item.dlna_profile,
-                                Database.null (),
-                                -1,
-                                item.creator};
+        var cursor = this.db.prepare (this.sql.make (SQLString.SAVE_METADATA));
+
+        // Fill common properties, using -1 and NULL for the others
+        cursor.bind_int64 (1, item.size);
+        cursor.bind_text (2, item.mime_type);
+        cursor.bind_int64 (3, -1);
+        cursor.bind_int64 (4, -1);
+        cursor.bind_text (5, item.upnp_class);
+        cursor.bind_null (6);
+        cursor.bind_null (7);
+        cursor.bind_text (8, item.date);
+        for (var i = 9; i <= 15; i++) {
+            cursor.bind_int64 (i, -1);
+        }
+        cursor.bind_text (16, item.id);
+        cursor.bind_text (17, item.dlna_profile);
+        cursor.bind_null (18);
+        cursor.bind_int64 (19, -1);
+        cursor.bind_text (20, item.creator);
 
         if (item is AudioItem) {
             var audio_item = item as AudioItem;
-            values[14] = audio_item.duration;
-            values[8] = audio_item.bitrate;
-            values[9] = audio_item.sample_freq;
-            values[10] = audio_item.bits_per_sample;
-            values[11] = audio_item.channels;
+            cursor.bind_int64 (15, audio_item.duration);
+            cursor.bind_int64 (9, audio_item.bitrate);
+            cursor.bind_int64 (10, audio_item.sample_freq);
+            cursor.bind_int64 (11, audio_item.bits_per_sample);
+            cursor.bind_int64 (12, audio_item.channels);
             if (item is MusicItem) {
                 var music_item = item as MusicItem;
-                values[5] = music_item.artist;
-                values[6] = music_item.album;
-                values[17] = music_item.genre;
-                values[12] = music_item.track_number;
-                values[18] = music_item.disc;
+                cursor.bind_text (6, music_item.artist);
+                cursor.bind_text (7, music_item.album);
+                cursor.bind_text (18, music_item.genre);
+                cursor.bind_int64 (13, music_item.track_number);
+                cursor.bind_int64 (19, music_item.disc);
             }
         }
 
         if (item is VisualItem) {
             var visual_item = item as VisualItem;
-            values[2] = visual_item.width;
-            values[3] = visual_item.height;
-            values[13] = visual_item.color_depth;
+            cursor.bind_int64 (3, visual_item.width);
+            cursor.bind_int64 (4, visual_item.height);
+            cursor.bind_int64 (14, visual_item.color_depth);
             if (item is VideoItem) {
                 var video_item = item as VideoItem;
-                values[5] = video_item.author;
+                cursor.bind_text (6, video_item.author);
             }
         }
 
         if (item is PlaylistItem) {
             var playlist_item = item as PlaylistItem;
 
-            values[5] = playlist_item.creator;
+            cursor.bind_text (6, playlist_item.creator);
         }
 
-        this.db.exec (this.sql.make (SQLString.SAVE_METADATA), values);
+        cursor.run ();
     }
 
     private void update_guarded_object (MediaObject object) throws Error {
@@ -823,37 +1179,31 @@ public class Rygel.MediaExport.MediaCache : Object {
     private void create_normal_object (MediaObject object,
                                        bool is_guarded) throws Error {
         int type = ObjectType.CONTAINER;
-        GLib.Value parent;
 
         if (object is MediaFileItem) {
             type = ObjectType.ITEM;
         }
 
-        if (object.parent == null) {
-            parent = Database.@null ();
-        } else {
-            parent = object.parent.id;
-        }
+        var cursor = this.db.prepare (this.sql.make (SQLString.INSERT));
+        cursor.bind_text (1, object.id);
+        cursor.bind_text (2, object.title);
+        cursor.bind_int64 (3, type);
+        cursor.bind_text (4, object.parent == null ? null : object.parent.id);
+        cursor.bind_int64 (5, object.modified);
+        cursor.bind_text (6, object.get_primary_uri ());
+        cursor.bind_int64 (7, object.object_update_id);
+        cursor.bind_int64 (8, -1);
+        cursor.bind_int64 (9, -1);
+        cursor.bind_int64 (10, is_guarded ? 1 : 0);
+        cursor.bind_text (11, object.ref_id);
 
-        GLib.Value[] values = { object.id,
-                                object.title,
-                                type,
-                                parent,
-                                object.modified,
-                                object.get_primary_uri (),
-                                object.object_update_id,
-                                -1,
-                                -1,
-                                is_guarded ? 1 : 0,
-                                object.ref_id ?? null
-                              };
         if (object is MediaContainer) {
             var container = object as MediaContainer;
-            values[7] = container.total_deleted_child_count;
-            values[8] = container.update_id;
+            cursor.bind_int64 (8, container.total_deleted_child_count);
+            cursor.bind_int64 (9, container.update_id);
         }
 
-        this.db.exec (this.sql.make (SQLString.INSERT), values);
+        cursor.run ();
     }
 
     /**
@@ -883,10 +1233,14 @@ public class Rygel.MediaExport.MediaCache : Object {
             db.begin ();
             db.exec (this.sql.make (SQLString.SCHEMA));
             db.exec (this.sql.make (SQLString.TRIGGER_COMMON));
-            db.exec (this.sql.make (SQLString.TABLE_CLOSURE));
+            db.exec (this.sql.make (SQLString.TABLE_HIERARCHY));
             db.exec (this.sql.make (SQLString.INDEX_COMMON));
-            db.exec (this.sql.make (SQLString.TRIGGER_CLOSURE));
+            db.exec (this.sql.make (SQLString.TRIGGER_HIERARCHY));
+            GLib.Value[] args = { this.sql.hierarchy.get_name () };
+            db.exec (this.sql.make (SQLString.SET_HIERARCHY), args);
             db.exec (this.sql.make (SQLString.TRIGGER_REFERENCE));
+            db.exec (this.sql.make (SQLString.TRIGGER_FILE_IDENTITY));
+            db.exec (this.sql.make (SQLString.TRIGGER_AGGREGATE));
             db.commit ();
             db.analyze ();
             this.save_reset_token (Uuid.string_random ());
@@ -900,6 +1254,22 @@ public class Rygel.MediaExport.MediaCache : Object {
         return false;
    }
 
+    /**
+     * Create the next object of a GET_OBJECT result, which lists the object
+     * after all of its ancestors.
+     *
+     * @param parent the object created from the previous row
+     * @param row the current row
+     */
+    private MediaObject get_object_with_parent (MediaObject? parent,
+                                                Database.Row row) {
+        var parent_container = parent as MediaContainer;
+        var object = this.get_object_from_row (parent_container, row);
+        object.parent_ref = parent_container;
+
+        return object;
+    }
+
     /**
      * Create a new container or item based on a SQL result.
      *
@@ -907,16 +1277,16 @@ public class Rygel.MediaExport.MediaCache : Object {
      * after serializing the result.
      *
      * @param parent The object's parent container.
-     * @param statement a SQLite result indicating the container's details.
+     * @param row a SQL result row with the container's details.
      */
-    private MediaObject? get_object_from_statement (MediaContainer? parent,
-                                                    Statement       statement) {
+    private MediaObject? get_object_from_row (MediaContainer? parent,
+                                              Database.Row    row) {
         MediaObject object = null;
-        unowned string title = statement.column_text (DetailColumn.TITLE);
-        unowned string object_id = statement.column_text (DetailColumn.ID);
-        unowned string uri = statement.column_text (DetailColumn.URI);
+        unowned string title = row.column_text (DetailColumn.TITLE);
+        unowned string object_id = row.column_text (DetailColumn.ID);
+        unowned string uri = row.column_text (DetailColumn.URI);
 
-        switch (statement.column_int (DetailColumn.TYPE)) {
+        switch (row.column_int (DetailColumn.TYPE)) {
             case 0:
                 // this is a container
                 object = factory.get_container (object_id, title, 0, uri);
@@ -925,21 +1295,21 @@ public class Rygel.MediaExport.MediaCache : Object {
                 if (uri != null) {
                     container.add_uri (uri);
                 }
-                container.total_deleted_child_count = (uint32) statement.column_int64
+                container.total_deleted_child_count = (uint32) row.column_int64
                                         (DetailColumn.DELETED_CHILD_COUNT);
-                container.update_id = (uint) statement.column_int64
+                container.update_id = (uint) row.column_int64
                                         (DetailColumn.CONTAINER_UPDATE_ID);
                 break;
             case 1:
                 // this is an item
-                unowned string upnp_class = statement.column_text
+                unowned string upnp_class = row.column_text
                                         (DetailColumn.CLASS);
                 object = factory.get_item (parent,
                                            object_id,
                                            title,
                                            upnp_class);
                 var item = object as MediaFileItem;
-                fill_item (statement, item);
+                fill_item (row, item);
 
                 if (uri != null) {
                     item.add_uri (uri);
@@ -952,60 +1322,60 @@ public class Rygel.MediaExport.MediaCache : Object {
         }
 
         if (object != null) {
-            object.modified = statement.column_int64 (DetailColumn.TIMESTAMP);
+            object.modified = row.column_int64 (DetailColumn.TIMESTAMP);
             var item = object as MediaFileItem;
             if (object.modified  == int64.MAX && item != null) {
                 object.modified = 0;
                 item.place_holder = true;
             }
-            object.object_update_id = (uint) statement.column_int64
+            object.object_update_id = (uint) row.column_int64
                                         (DetailColumn.OBJECT_UPDATE_ID);
-            object.ref_id = statement.column_text (DetailColumn.REFERENCE_ID);
+            object.ref_id = row.column_text (DetailColumn.REFERENCE_ID);
         }
 
         return object;
     }
 
-    private void fill_item (Statement statement, MediaFileItem item) {
+    private void fill_item (Database.Row row, MediaFileItem item) {
         // Fill common properties
-        item.date = statement.column_text (DetailColumn.DATE);
-        item.mime_type = statement.column_text (DetailColumn.MIME_TYPE);
-        item.dlna_profile = statement.column_text (DetailColumn.DLNA_PROFILE);
-        item.size = statement.column_int64 (DetailColumn.SIZE);
-        item.creator = statement.column_text (DetailColumn.CREATOR);
+        item.date = row.column_text (DetailColumn.DATE);
+        item.mime_type = row.column_text (DetailColumn.MIME_TYPE);
+        item.dlna_profile = row.column_text (DetailColumn.DLNA_PROFILE);
+        item.size = row.column_int64 (DetailColumn.SIZE);
+        item.creator = row.column_text (DetailColumn.CREATOR);
 
         if (item is AudioItem) {
             var audio_item = item as AudioItem;
-            audio_item.duration = (long) statement.column_int64
+            audio_item.duration = (long) row.column_int64
                                         (DetailColumn.DURATION);
-            audio_item.bitrate = statement.column_int (DetailColumn.BITRATE);
-            audio_item.sample_freq = statement.column_int
+            audio_item.bitrate = row.column_int (DetailColumn.BITRATE);
+            audio_item.sample_freq = row.column_int
                                         (DetailColumn.SAMPLE_FREQ);
-            audio_item.bits_per_sample = statement.column_int
+            audio_item.bits_per_sample = row.column_int
                                         (DetailColumn.BITS_PER_SAMPLE);
-            audio_item.channels = statement.column_int (DetailColumn.CHANNELS);
+            audio_item.channels = row.column_int (DetailColumn.CHANNELS);
             if (item is MusicItem) {
                 var music_item = item as MusicItem;
-                music_item.artist = statement.column_text (DetailColumn.AUTHOR);
-                music_item.album = statement.column_text (DetailColumn.ALBUM);
-                music_item.genre = statement.column_text (DetailColumn.GENRE);
-                music_item.track_number = statement.column_int
+                music_item.artist = row.column_text (DetailColumn.AUTHOR);
+                music_item.album = row.column_text (DetailColumn.ALBUM);
+                music_item.genre = row.column_text (DetailColumn.GENRE);
+                music_item.track_number = row.column_int
                                         (DetailColumn.TRACK);
-                music_item.disc_number = statement.column_int (DetailColumn.DISC);
+                music_item.disc_number = row.column_int (DetailColumn.DISC);
                 music_item.lookup_album_art ();
             }
         }
 
         if (item is VisualItem) {
             var visual_item = item as VisualItem;
-            visual_item.width = statement.column_int (DetailColumn.WIDTH);
-            visual_item.height = statement.column_int (DetailColumn.HEIGHT);
-            visual_item.color_depth = statement.column_int
+            visual_item.width = row.column_int (DetailColumn.WIDTH);
+            visual_item.height = row.column_int (DetailColumn.HEIGHT);
+            visual_item.color_depth = row.column_int
                                         (DetailColumn.COLOR_DEPTH);
         }
     }
 
-    private static string translate_search_expression
+    private string translate_search_expression
                                         (SearchExpression? expression,
                                          Array<GLib.Value>        args,
                                          string            prefix = "WHERE")
@@ -1014,12 +1384,26 @@ public class Rygel.MediaExport.MediaCache : Object {
             return "";
         }
 
-        var filter = MediaCache.search_expression_to_sql (expression, args);
+        var key = QueryPlanCache.make_filter_key (expression, prefix);
+        var filter = this.plans.lookup_filter (key);
+        if (filter == null) {
+            var filter_args = new GLib.Array<GLib.Value> ();
+            var sql = this.search_expression_to_sql (expression, filter_args);
 
-        return " %s %s".printf (prefix, filter);
+            filter = new QueryPlanCache.Filter ();
+            filter.sql = " %s %s".printf (prefix, sql);
+            filter.args = filter_args.data;
+            this.plans.store_filter (key, filter);
+        }
+
+        foreach (var arg in filter.args) {
+            args.append_val (arg);
+        }
+
+        return filter.sql;
     }
 
-    private static string? search_expression_to_sql
+    private string? search_expression_to_sql
                                         (SearchExpression? expression,
                                          GLib.Array<GLib.Value>   args)
                                          throws Error {
@@ -1028,23 +1412,23 @@ public class Rygel.MediaExport.MediaCache : Object {
         }
 
         if (expression is LogicalExpression) {
-            return MediaCache.logical_expression_to_sql
+            return this.logical_expression_to_sql
                                         (expression as LogicalExpression, args);
         } else {
-            return MediaCache.relational_expression_to_sql
+            return this.relational_expression_to_sql
                                         (expression as RelationalExpression,
                                          args);
         }
     }
 
-    private static string logical_expression_to_sql
+    private string logical_expression_to_sql
                                         (LogicalExpression expression,
                                          GLib.Array<GLib.Value>   args)
                                          throws Error {
-        string left_sql_string = MediaCache.search_expression_to_sql
+        string left_sql_string = this.search_expression_to_sql
                                         (expression.operand1,
                                          args);
-        string right_sql_string = MediaCache.search_expression_to_sql
+        string right_sql_string = this.search_expression_to_sql
                                         (expression.operand2,
                                          args);
         unowned string operator_sql_string = "OR";
@@ -1058,12 +1442,20 @@ public class Rygel.MediaExport.MediaCache : Object {
                                     right_sql_string);
     }
 
+    /**
+     * Map a UPnP property to its column.
+     *
+     * Text properties that are compared with locale collation also have a
+     * column holding a pre-computed collation key, which is returned in
+     * @key_column. Such columns can be compared and sorted using plain byte
+     * comparison.
+     */
     private static string? map_operand_to_column (string     operand,
-                                                  out string? collate = null,
+                                                  out string? key_column = null,
                                                   bool        for_sort = false)
                                                   throws Error {
         string column = null;
-        bool use_collation = false;
+        key_column = null;
 
         switch (operand) {
             case "res":
@@ -1083,16 +1475,16 @@ public class Rygel.MediaExport.MediaCache : Object {
                 break;
             case "dc:title":
                 column = "o.title";
-                use_collation = true;
+                key_column = "o.title_key";
                 break;
             case "upnp:artist":
             case "upnp:author":
                 column = "m.author";
-                use_collation = true;
+                key_column = "m.author_key";
                 break;
             case "dc:creator":
                 column = "m.creator";
-                use_collation = true;
+                key_column = "m.creator_key";
                 break;
             case "dc:date":
                 if (for_sort) {
@@ -1103,13 +1495,13 @@ public class Rygel.MediaExport.MediaCache : Object {
                 break;
             case "upnp:album":
                 column = "m.album";
-                use_collation = true;
+                key_column = "m.album_key";
                 break;
             case "upnp:genre":
             case "dc:genre":
                 // FIXME: Remove dc:genre, upnp:genre is the correct one
                 column = "m.genre";
-                use_collation = true;
+                key_column = "m.genre_key";
                 break;
             case "upnp:originalTrackNumber":
                 column = "m.track";
@@ -1129,24 +1521,18 @@ public class Rygel.MediaExport.MediaCache : Object {
                 throw new MediaCacheError.UNSUPPORTED_SEARCH (message);
         }
 
-        if (use_collation) {
-            collate = "COLLATE CASEFOLD";
-        } else {
-            collate = "";
-        }
-
         return column;
     }
 
-    private static string? relational_expression_to_sql
+    private string? relational_expression_to_sql
                                         (RelationalExpression exp,
                                          GLib.Array<GLib.Value>      args)
                                          throws Error {
         GLib.Value? v = null;
-        string collate = null;
+        string key_column = null;
 
         string column = MediaCache.map_operand_to_column (exp.operand1,
-                                                          out collate);
+                                                          out key_column);
         SqlOperator operator;
 
         switch (exp.op) {
@@ -1165,16 +1551,29 @@ public class Rygel.MediaExport.MediaCache : Object {
             case SearchCriteriaOp.LEQ:
             case SearchCriteriaOp.GREATER:
             case SearchCriteriaOp.GEQ:
-                v = exp.operand2;
+                if (key_column != null) {
+                    v = exp.operand2.collate_key ();
+                    column = key_column;
+                } else {
+                    v = exp.operand2;
+                }
                 operator = new SqlOperator.from_search_criteria_op
-                                            (exp.op, column, collate);
+                                            (exp.op, column, "");
                 break;
             case SearchCriteriaOp.CONTAINS:
-                operator = new SqlFunction ("contains", column);
-                v = exp.operand2;
-                break;
             case SearchCriteriaOp.DOES_NOT_CONTAIN:
-                operator = new SqlFunction ("NOT contains", column);
+                var negate = exp.op == SearchCriteriaOp.DOES_NOT_CONTAIN;
+                var fts_filter = this.full_text_filter (column,
+                                                        exp.operand2,
+                                                        negate,
+                                                        args);
+                if (fts_filter != null) {
+                    return fts_filter;
+                }
+
+                operator = new SqlFunction (negate ? "NOT contains"
+                                                   : "contains",
+                                            column);
                 v = exp.operand2;
                 break;
             case SearchCriteriaOp.DERIVED_FROM:
@@ -1194,33 +1593,312 @@ public class Rygel.MediaExport.MediaCache : Object {
         return operator.to_string ();
     }
 
+    /**
+     * Translate a (NOT) contains on @column into a lookup in the full-text
+     * index.
+     *
+     * The trigram tokenizer folds case like contains() does, but it cannot
+     * match needles shorter than three characters; those, and columns that
+     * are not indexed, return null to use contains() instead.
+     *
+     * Like contains(), a missing value does not contain anything, so objects
+     * without meta_data match every doesNotContain on its columns.
+     */
+    private string? full_text_filter (string                 column,
+                                      string                 needle,
+                                      bool                   negate,
+                                      GLib.Array<GLib.Value> args) {
+        if (!this.full_text_index || needle.char_count () < 3) {
+            return null;
+        }
+
+        unowned string fts_column;
+        switch (column) {
+            case "o.title":
+                fts_column = "title";
+                break;
+            case "m.author":
+                fts_column = "author";
+                break;
+            case "m.album":
+                fts_column = "album";
+                break;
+            case "m.creator":
+                fts_column = "creator";
+                break;
+            case "m.genre":
+                fts_column = "genre";
+                break;
+            default:
+                return null;
+        }
+
+        GLib.Value v = "%s : \"%s\"".printf (fts_column,
+                                             needle.replace ("\"", "\"\""));
+        args.append_val (v);
+
+        if (fts_column == "title") {
+            var filter = "o.rowid %s (SELECT rowid FROM title_fts " +
+                         "WHERE title_fts MATCH ?)";
+
+            return filter.printf (negate ? "NOT IN" : "IN");
+        }
+
+        if (negate) {
+            return "(m.rowid IS NULL OR m.rowid NOT IN " +
+                   "(SELECT rowid FROM meta_data_fts " +
+                   "WHERE meta_data_fts MATCH ?))";
+        }
+
+        return "m.rowid IN (SELECT rowid FROM meta_data_fts " +
+               "WHERE meta_data_fts MATCH ?)";
+    }
+
+    /**
+     * Prepare a sorted query for the page of rows starting at @offset.
+     *
+     * If the previous page of the same query ended at @offset, the query
+     * continues right after the last row of that page instead of skipping
+     * @offset rows.
+     *
+     * @param template SQL query with placeholders for the sort columns, the
+     * filter and the sort order
+     * @param filter filter of the query, may be empty
+     * @param condition_prefix SQL to join the paging condition to @filter
+     * @param args values to bind for the filter
+     * @param update_id an id that changes whenever the query result changes
+     */
+    private KeysetPage prepare_page (string                 template,
+                                     string                 filter,
+                                     string                 condition_prefix,
+                                     string                 sort_criteria,
+                                     GLib.Array<GLib.Value> args,
+                                     uint32                 update_id,
+                                     long                   offset,
+                                     long                   max_count)
+                                     throws Error {
+        var plan = this.plans.lookup_sort_order (sort_criteria);
+        if (plan == null) {
+            plan = new QueryPlanCache.SortOrder ();
+            plan.sql = MediaCache.translate_sort_criteria
+                                        (sort_criteria,
+                                         out plan.extra_columns,
+                                         out plan.column_count,
+                                         true,
+                                         "o.upnp_id",
+                                         out plan.columns,
+                                         out plan.descending);
+            this.plans.store_sort_order (sort_criteria, plan);
+        }
+
+        unowned string extra_columns = plan.extra_columns;
+        unowned string sort_order = plan.sql;
+        unowned string[] sort_columns = plan.columns;
+        var key = KeysetCache.make_key (template.printf (extra_columns,
+                                                         filter,
+                                                         sort_order),
+                                        args,
+                                        update_id);
+
+        var sql_filter = filter;
+        long sql_offset = offset;
+        var last_key = this.keysets.lookup (key, offset);
+        if (last_key != null) {
+            debug ("Continuing at offset %ld after the previous page", offset);
+            var condition = KeysetCache.make_condition (sort_columns,
+                                                        plan.descending,
+                                                        last_key,
+                                                        args);
+            sql_filter = "%s %s %s".printf (filter,
+                                            condition_prefix,
+                                            condition);
+            sql_offset = 0;
+        }
+
+        GLib.Value v = sql_offset;
+        args.append_val (v);
+        v = max_count;
+        args.append_val (v);
+
+        debug ("Parameters to bind: %u", args.length);
+        for (int i = 0; i < args.length; i++) {
+            var arg = args.index (i);
+            debug ("Arg %d: %s", i, arg.holds (typeof (string)) ?
+                                        arg.get_string () :
+                                        arg.strdup_contents ());
+        }
+
+        return new KeysetPage (this.keysets,
+                               key,
+                               template.printf (extra_columns,
+                                                sql_filter,
+                                                sort_order),
+                               args.data,
+                               offset,
+                               max_count,
+                               (int) DetailColumn.REFERENCE_ID + 1,
+                               sort_columns.length);
+    }
+
+    /**
+     * Run a query on a worker thread and copy its result rows.
+     */
+    private async Gee.List<Database.Row> read_rows
+                                        (string        sql,
+                                         GLib.Value[]  args,
+                                         Cancellable?  cancellable)
+                                         throws Error {
+        var rows = new ArrayList<Database.Row> ();
+
+        yield this.db.read ((connection) => {
+            var cursor = connection.exec_cursor (sql, args);
+            foreach (var statement in cursor) {
+                rows.add (new Database.RowSnapshot (statement));
+            }
+        }, cancellable);
+
+        return rows;
+    }
+
     private Database.Cursor exec_cursor (SQLString      id,
                                         GLib.Value[]?  values = null)
                                         throws DatabaseError {
         return this.db.exec_cursor (this.sql.make (id), values);
     }
 
+    /**
+     * Map a request for all values of @attribute for one class to the
+     * meta_data_aggregate table.
+     *
+     * This covers the top level of the virtual folders, such as all artists
+     * of music tracks; more specific expressions need the full query.
+     *
+     * @return true if the aggregate table can answer the request
+     */
+    private static bool map_to_aggregate (string            attribute,
+                                          SearchExpression? expression,
+                                          out string        aggregate,
+                                          out string        upnp_class) {
+        aggregate = null;
+        upnp_class = null;
+
+        var rel_expression = expression as RelationalExpression;
+        if (rel_expression == null ||
+            rel_expression.operand1 != "upnp:class" ||
+            rel_expression.op != SearchCriteriaOp.EQ) {
+            return false;
+        }
+
+        switch (attribute) {
+            case "upnp:artist":
+            case "upnp:author":
+                aggregate = "author";
+                break;
+            case "upnp:album":
+                aggregate = "album";
+                break;
+            case "upnp:genre":
+            case "dc:genre":
+                aggregate = "genre";
+                break;
+            case "dc:creator":
+                aggregate = "creator";
+                break;
+            case "dc:date":
+                aggregate = "year";
+                break;
+            default:
+                return false;
+        }
+
+        upnp_class = rel_expression.operand2;
+
+        return true;
+    }
+
+    /**
+     * Get the sort direction of the aggregated values for @sort_criteria.
+     *
+     * The values can only be sorted by themselves; like for the full query,
+     * dc:title refers to the value and upnp:class is the same for all of
+     * them.
+     *
+     * @return false if @sort_criteria cannot be applied to the values
+     */
+    private static bool get_aggregate_sort_order (string     attribute,
+                                                  string     sort_criteria,
+                                                  out string direction) {
+        direction = "ASC";
+
+        foreach (var field in sort_criteria.split (",")) {
+            if (field == "") {
+                continue;
+            }
+
+            var property = field.substring (1);
+            if (property == "upnp:class") {
+                continue;
+            }
+
+            if (property != "dc:title" && property != attribute) {
+                return false;
+            }
+
+            if (field[0] == '-') {
+                direction = "DESC";
+            }
+
+            break;
+        }
+
+        return true;
+    }
+
     private int query_value (SQLString      id,
                              GLib.Value[]?  values = null)
                              throws DatabaseError {
         return this.db.query_value (this.sql.make (id), values);
     }
 
+    /**
+     * Translate UPnP sort criteria to an ORDER BY clause.
+     *
+     * Text columns are sorted by their collation key unless @use_keys is
+     * false, in which case the CASEFOLD collation is used on the text itself.
+     *
+     * If @tie_breaker is given, it is used as the last sort column so that
+     * the order of the rows is unique.
+     */
     private static string translate_sort_criteria
-                                        (string sort_criteria,
-                                         out string extra_columns = null,
-                                         out int column_count = null) {
-        string? collate;
+                                        (string       sort_criteria,
+                                         out string   extra_columns = null,
+                                         out int      column_count = null,
+                                         bool         use_keys = true,
+                                         string?      tie_breaker = null,
+                                         out string[] sort_columns = null,
+                                         out bool[]   descending = null) {
+        string? key_column;
         var builder = new StringBuilder("ORDER BY ");
         var column_builder = new StringBuilder ();
         var fields = sort_criteria.split (",");
         column_count = fields.length;
+        string[] columns = {};
+        bool[] directions = {};
         foreach (unowned string field in fields) {
             try {
                 var column = MediaCache.map_operand_to_column
                                         (field[1:field.length],
-                                         out collate,
+                                         out key_column,
                                          true);
+                var collate = "";
+                if (key_column != null) {
+                    if (use_keys) {
+                        column = key_column;
+                    } else {
+                        collate = "COLLATE CASEFOLD";
+                    }
+                }
+
                 if (field != fields[0]) {
                     builder.append (",");
                 }
@@ -1230,12 +1908,26 @@ public class Rygel.MediaExport.MediaCache : Object {
                                        collate,
                                        field[0] == '-' ? "DESC" : "ASC");
                 column_builder.append (column);
+                columns += column;
+                directions += field[0] == '-';
             } catch (Error error) {
                 warning (_("Skipping unsupported sort field: %s"), field);
             }
         }
 
+        if (tie_breaker != null) {
+            if (columns.length > 0) {
+                builder.append (",");
+            }
+            builder.append_printf ("%s ASC ", tie_breaker);
+            column_builder.append_printf (",%s", tie_breaker);
+            columns += tie_breaker;
+            directions += false;
+        }
+
         extra_columns = column_builder.str;
+        sort_columns = columns;
+        descending = directions;
 
         return builder.str;
     }
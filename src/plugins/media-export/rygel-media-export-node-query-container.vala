@@ -80,15 +80,10 @@ internal class Rygel.MediaExport.NodeQueryContainer : QueryContainer {
 
     public override int count_children () {
         try {
-            var data = this.media_db.get_object_attribute_by_search_expression
+            return this.media_db.get_object_attribute_count_by_search_expression
                                         (this.attribute,
                                          this.expression,
-                                         "+dc:title",
-                                         0,
-                                         -1,
                                          this.add_all_container ());
-
-            return data.size;
         } catch (Error error) {
             warning (_("Failed to get child count: %s"), error.message);
 
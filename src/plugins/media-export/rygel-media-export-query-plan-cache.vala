@@ -0,0 +1,130 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Recently used translations of searches to SQL.
+ *
+ * Clients repeat the same few searches for every page they fetch. Keeping
+ * the translated filter with the values to bind, and the translated sort
+ * order, saves walking the expression and building the SQL again. As the
+ * SQL text stays the same, the database can also re-use the prepared
+ * statement.
+ */
+internal class Rygel.MediaExport.QueryPlanCache : Object {
+    private const int MAX_ENTRIES = 64;
+
+    /**
+     * A search expression translated to an SQL condition.
+     */
+    public class Filter {
+        public string sql;
+        /// The values to bind to the placeholders of sql, in order
+        public GLib.Value[] args;
+    }
+
+    /**
+     * Sort criteria translated to an ORDER BY clause.
+     */
+    public class SortOrder {
+        public string sql;
+        /// The sort columns, each one preceded by a comma
+        public string extra_columns;
+        public int column_count;
+        public string[] columns;
+        public bool[] descending;
+    }
+
+    private class Entry {
+        public Filter? filter;
+        public SortOrder? sort_order;
+    }
+
+    private LruCache<string, Entry> entries;
+
+    public QueryPlanCache () {
+        this.entries = new LruCache<string, Entry> (MAX_ENTRIES);
+    }
+
+    /**
+     * Create the key identifying @expression.
+     *
+     * Unlike SearchExpression.to_string (), the key is unambiguous whatever
+     * the operands contain.
+     *
+     * @param expression the search expression
+     * @param prefix SQL keyword joining the filter to the query
+     */
+    public static string make_filter_key (SearchExpression expression,
+                                          string           prefix) {
+        var builder = new StringBuilder ("F");
+        builder.append (prefix);
+        QueryPlanCache.append_expression (builder, expression);
+
+        return builder.str;
+    }
+
+    public Filter? lookup_filter (string key) {
+        var entry = this.entries[key];
+
+        return entry != null ? entry.filter : null;
+    }
+
+    public void store_filter (string key, Filter filter) {
+        var entry = this.store (key);
+        entry.filter = filter;
+    }
+
+    public SortOrder? lookup_sort_order (string sort_criteria) {
+        var entry = this.entries["S" + sort_criteria];
+
+        return entry != null ? entry.sort_order : null;
+    }
+
+    public void store_sort_order (string sort_criteria, SortOrder sort_order) {
+        var entry = this.store ("S" + sort_criteria);
+        entry.sort_order = sort_order;
+    }
+
+    private Entry store (string key) {
+        var entry = new Entry ();
+        this.entries[key] = entry;
+
+        return entry;
+    }
+
+    private static void append_expression (StringBuilder    builder,
+                                           SearchExpression? expression) {
+        if (expression is LogicalExpression) {
+            var logical = expression as LogicalExpression;
+            builder.append_printf ("(%d", (int) logical.op);
+            QueryPlanCache.append_expression (builder, logical.operand1);
+            QueryPlanCache.append_expression (builder, logical.operand2);
+            builder.append_c (')');
+        } else if (expression is RelationalExpression) {
+            var relational = expression as RelationalExpression;
+            builder.append_printf ("[%d %s %u:",
+                                   (int) relational.op,
+                                   relational.operand1,
+                                   (uint) relational.operand2.length);
+            builder.append (relational.operand2);
+            builder.append_c (']');
+        } else {
+            builder.append_c ('-');
+        }
+    }
+}
@@ -88,6 +88,12 @@ public class Rygel.MediaExport.RootContainer : TrackableDbContainer {
     public override async MediaObject? find_object (string       id,
                                                     Cancellable? cancellable)
                                                     throws Error {
+        // Whatever a client is looking at should not wait for the
+        // background scan
+        if (this.harvester != null) {
+            this.harvester.prioritize (id);
+        }
+
         var object = yield base.find_object (id, cancellable);
 
         if (object != null) {
@@ -439,6 +445,14 @@ public class Rygel.MediaExport.RootContainer : TrackableDbContainer {
         this.harvester_signal_id = this.harvester.done.connect
                                         (on_initial_harvesting_done);
 
+        // Keep the background work out of the way while clients stream
+        this.stream_started.connect (() => {
+            this.harvester.stream_started ();
+        });
+        this.stream_finished.connect (() => {
+            this.harvester.stream_finished ();
+        });
+
         // For each location that we want the harvester to scan,
         // remove it from the cache.
         foreach (var file in this.harvester.locations) {
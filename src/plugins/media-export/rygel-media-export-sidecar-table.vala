@@ -0,0 +1,81 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/**
+ * Keep the album art and subtitle look-ups of the SidecarCache in the
+ * sidecar table of the media cache.
+ *
+ * The look-ups then survive a restart, so items read from the database do
+ * not touch the file system even for the first Browse.
+ */
+internal class Rygel.MediaExport.SidecarTable : Object, SidecarStore {
+    private unowned Database.Database db;
+    private unowned SQLFactory sql;
+
+    public SidecarTable (Database.Database db, SQLFactory sql) {
+        this.db = db;
+        this.sql = sql;
+    }
+
+    public string? lookup (string group, string name) throws Error {
+        GLib.Value[] values = { group, name };
+        var query = this.sql.make (SQLString.GET_SIDECAR);
+        var cursor = this.db.exec_cursor (query, values);
+        foreach (var statement in cursor) {
+            return statement.column_text (0);
+        }
+
+        return null;
+    }
+
+    public void save (SidecarRecord[] records) throws Error {
+        var query = this.sql.make (SQLString.SAVE_SIDECAR);
+
+        try {
+            this.db.begin ();
+            foreach (var record in records) {
+                GLib.Value[] values = { record.group,
+                                        record.name,
+                                        record.value };
+                this.db.exec (query, values);
+            }
+            this.db.commit ();
+        } catch (Error error) {
+            this.db.rollback ();
+
+            throw error;
+        }
+    }
+
+    public void invalidate (string[] groups) throws Error {
+        var query = this.sql.make (SQLString.DELETE_SIDECAR);
+
+        try {
+            this.db.begin ();
+            foreach (var group in groups) {
+                GLib.Value[] values = { group };
+                this.db.exec (query, values);
+            }
+            this.db.commit ();
+        } catch (Error error) {
+            this.db.rollback ();
+
+            throw error;
+        }
+    }
+}
@@ -52,6 +52,33 @@ internal enum Rygel.MediaExport.DetailColumn {
     REFERENCE_ID
 }
 
+/**
+ * How the containment of objects is stored.
+ */
+internal enum Rygel.MediaExport.Hierarchy {
+    /// One row per (ancestor, descendant) pair in the closure table
+    CLOSURE,
+    /// The path of each object in the object_path table
+    PATH;
+
+    public static Hierarchy from_name (string? name) {
+        if (name == "path") {
+            return PATH;
+        }
+
+        return CLOSURE;
+    }
+
+    public unowned string get_name () {
+        switch (this) {
+            case PATH:
+                return "path";
+            default:
+                return "closure";
+        }
+    }
+}
+
 internal enum Rygel.MediaExport.SQLString {
     SAVE_METADATA,
     INSERT,
@@ -67,8 +94,12 @@ internal enum Rygel.MediaExport.SQLString {
     EXISTS,
     CHILD_IDS,
     TABLE_METADATA,
-    TABLE_CLOSURE,
-    TRIGGER_CLOSURE,
+    TABLE_HIERARCHY,
+    TRIGGER_HIERARCHY,
+    FILL_HIERARCHY,
+    DROP_HIERARCHY,
+    GET_HIERARCHY,
+    SET_HIERARCHY,
     TRIGGER_COMMON,
     INDEX_COMMON,
     SCHEMA,
@@ -83,25 +114,59 @@ internal enum Rygel.MediaExport.SQLString {
     CREATE_IGNORELIST_TABLE,
     CREATE_IGNORELIST_INDEX,
     ADD_TO_IGNORELIST,
-    CHECK_IGNORELIST
+    CHECK_IGNORELIST,
+    TABLE_FILE_IDENTITY,
+    TRIGGER_FILE_IDENTITY,
+    SAVE_FILE_IDENTITY,
+    FIND_BY_FILE_IDENTITY,
+    TABLE_FULL_TEXT_INDEX,
+    TRIGGER_FULL_TEXT_INDEX,
+    FILL_FULL_TEXT_INDEX,
+    DROP_FULL_TEXT_INDEX,
+    HAS_FULL_TEXT_INDEX,
+    GET_COLLATION,
+    SET_COLLATION,
+    UPDATE_COLLATION_KEYS,
+    TABLE_AGGREGATE,
+    TRIGGER_AGGREGATE,
+    FILL_AGGREGATE,
+    PRUNE_AGGREGATE,
+    GET_AGGREGATE_VALUES,
+    GET_AGGREGATE_COUNT,
+    TABLE_SIDECAR,
+    GET_SIDECAR,
+    SAVE_SIDECAR,
+    DELETE_SIDECAR
 }
 
 internal class Rygel.MediaExport.SQLFactory : Object {
+    /**
+     * The hierarchy used by the database; queries on the containment of
+     * objects are returned for it.
+     */
+    public Hierarchy hierarchy { get; set; default = Hierarchy.CLOSURE; }
+
+    // SQL prefixed with the name of its SQLString, see label_queries ()
+    private HashTable<string, string> labelled;
+
     private const string SAVE_META_DATA_STRING =
     "INSERT OR REPLACE INTO meta_data " +
         "(size, mime_type, width, height, class, " +
          "author, album, date, bitrate, " +
          "sample_freq, bits_per_sample, channels, " +
          "track, color_depth, duration, object_fk, " +
-         "dlna_profile, genre, disc, creator) VALUES " +
-         "(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)";
+         "dlna_profile, genre, disc, creator, " +
+         "author_key, album_key, genre_key, creator_key) VALUES " +
+         "(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?," +
+          "collate_key(?6),collate_key(?7)," +
+          "collate_key(?18),collate_key(?20))";
 
     private const string INSERT_OBJECT_STRING =
     "INSERT OR REPLACE INTO Object " +
         "(upnp_id, title, type_fk, parent, timestamp, uri, " +
          "object_update_id, deleted_child_count, container_update_id, " +
-         "is_guarded, reference_id) VALUES " +
-        "(?,?,?,?,?,?,?,?,?,?,?)";
+         "is_guarded, reference_id, title_key) VALUES " +
+        "(?,?,?,?,?,?,?,?,?,?,?,collate_key(?2))";
 
     private const string UPDATE_GUARDED_OBJECT_STRING =
     "UPDATE Object SET " +
@@ -118,6 +183,21 @@ internal class Rygel.MediaExport.SQLFactory : Object {
     "DELETE FROM Object WHERE upnp_id IN " +
         "(SELECT descendant FROM closure WHERE ancestor = ?)";
 
+    /*
+     * The path of an object is the number of each of its ancestors and of
+     * itself in object_path, each followed by a '/'. All descendants of an
+     * object share its path as prefix, so they are found by a range scan on
+     * the path index: '0' is the character following '/'.
+     */
+    private const string PATH_DESCENDANTS_STRING =
+    "FROM object_path a " +
+        "JOIN object_path d ON a.upnp_id = ? AND d.path >= a.path " +
+                             "AND d.path < rtrim(a.path, '/') || '0' ";
+
+    private const string DELETE_BY_ID_BY_PATH_STRING =
+    "DELETE FROM Object WHERE upnp_id IN " +
+        "(SELECT d.upnp_id " + PATH_DESCENDANTS_STRING + ")";
+
     private const string ALL_DETAILS_STRING =
     "o.type_fk, o.title, m.size, m.mime_type, m.width, " +
     "m.height, m.class, m.creator, m.author, m.album, m.date, m.bitrate, " +
@@ -133,6 +213,19 @@ internal class Rygel.MediaExport.SQLFactory : Object {
         "LEFT OUTER JOIN meta_data m ON (o.upnp_id = m.object_fk) " +
             "WHERE c.descendant = ? ORDER BY c.depth DESC";
 
+    private const string GET_OBJECT_WITH_ANCESTORS =
+    "WITH RECURSIVE ancestors (id, depth) AS (" +
+        "SELECT ?, 0 " +
+        "UNION ALL " +
+        "SELECT o.parent, a.depth + 1 FROM Object o " +
+            "JOIN ancestors a ON o.upnp_id = a.id " +
+            "WHERE o.parent IS NOT NULL) " +
+    "SELECT " + ALL_DETAILS_STRING +
+    "FROM ancestors a " +
+        "JOIN Object o ON o.upnp_id = a.id " +
+        "LEFT OUTER JOIN meta_data m ON (o.upnp_id = m.object_fk) " +
+    "ORDER BY a.depth DESC";
+
     /**
      * This is the database query used to retrieve the children for a
      * given object.
@@ -142,26 +235,45 @@ internal class Rygel.MediaExport.SQLFactory : Object {
      *   - by upnp_class: items are sorted according to their class
      *   - by track: sorted by track
      *   - and after that alphabetically
+     *
+     * The placeholders are the sort columns, which are appended to the
+     * result, an additional filter and the sort order.
      */
     private const string GET_CHILDREN_STRING =
-    "SELECT " + ALL_DETAILS_STRING +
+    "SELECT " + ALL_DETAILS_STRING + "%s " +
     "FROM Object o " +
         "JOIN Closure c ON (o.upnp_id = c.descendant) " +
         "LEFT OUTER JOIN meta_data m " +
         "ON c.descendant = m.object_fk " +
-    "WHERE c.ancestor = ? AND c.depth = 1 %s" +
+    "WHERE c.ancestor = ? AND c.depth = 1 %s %s" +
+    "LIMIT ?,?";
+
+    private const string GET_CHILDREN_BY_PARENT_STRING =
+    "SELECT " + ALL_DETAILS_STRING + "%s " +
+    "FROM Object o " +
+        "LEFT OUTER JOIN meta_data m " +
+        "ON o.upnp_id = m.object_fk " +
+    "WHERE o.parent = ? %s %s" +
     "LIMIT ?,?";
 
     private const string GET_OBJECTS_BY_FILTER_STRING_WITH_ANCESTOR =
-    "SELECT DISTINCT " + ALL_DETAILS_STRING +
+    "SELECT DISTINCT " + ALL_DETAILS_STRING + "%s " +
     "FROM Object o " +
         "JOIN Closure c ON o.upnp_id = c.descendant AND c.ancestor = ? " +
         "LEFT OUTER JOIN meta_data m " +
             "ON o.upnp_id = m.object_fk %s %s " +
     "LIMIT ?,?";
 
+    private const string GET_OBJECTS_BY_FILTER_STRING_BY_PATH =
+    "SELECT DISTINCT " + ALL_DETAILS_STRING + "%s " +
+    PATH_DESCENDANTS_STRING +
+        "JOIN Object o ON o.upnp_id = d.upnp_id " +
+        "LEFT OUTER JOIN meta_data m " +
+            "ON o.upnp_id = m.object_fk %s %s " +
+    "LIMIT ?,?";
+
     private const string GET_OBJECTS_BY_FILTER_STRING =
-    "SELECT DISTINCT " + ALL_DETAILS_STRING +
+    "SELECT DISTINCT " + ALL_DETAILS_STRING + "%s " +
     "FROM Object o " +
         "LEFT OUTER JOIN meta_data m " +
             "ON o.upnp_id = m.object_fk %s %s " +
@@ -173,6 +285,12 @@ internal class Rygel.MediaExport.SQLFactory : Object {
         "LEFT OUTER JOIN meta_data m " +
             "ON o.upnp_id = m.object_fk %s";
 
+    private const string GET_OBJECT_COUNT_BY_FILTER_STRING_BY_PATH =
+    "SELECT COUNT(o.type_fk) " + PATH_DESCENDANTS_STRING +
+        "JOIN Object o ON o.upnp_id = d.upnp_id " +
+        "LEFT OUTER JOIN meta_data m " +
+            "ON o.upnp_id = m.object_fk %s";
+
     private const string CHECK_IGNORELIST_STRING =
     "SELECT COUNT(1) FROM ignorelist b " +
         "WHERE b.uri = ?";
@@ -188,8 +306,9 @@ internal class Rygel.MediaExport.SQLFactory : Object {
     "SELECT COUNT(upnp_id) FROM Object WHERE Object.parent = ?";
 
     private const string OBJECT_EXISTS_STRING =
-    "SELECT COUNT(1), timestamp, m.size FROM Object " +
+    "SELECT COUNT(1), timestamp, m.size, f.inode FROM Object " +
         "JOIN meta_data m ON m.object_fk = upnp_id " +
+        "LEFT OUTER JOIN file_identity f ON f.uri = Object.uri " +
         "WHERE Object.uri = ?";
 
     private const string GET_CHILD_ID_STRING =
@@ -200,7 +319,7 @@ internal class Rygel.MediaExport.SQLFactory : Object {
         "WHERE _column IS NOT NULL %s %s" +
     "LIMIT ?,?";
 
-    internal const string SCHEMA_VERSION = "18";
+    internal const string SCHEMA_VERSION = "24";
     internal const string CREATE_META_DATA_TABLE_STRING =
     "CREATE TABLE meta_data (size INTEGER NOT NULL, " +
                             "mime_type TEXT NOT NULL, " +
@@ -221,6 +340,10 @@ internal class Rygel.MediaExport.SQLFactory : Object {
                             "track INTEGER, " +
                             "disc INTEGER, " +
                             "color_depth INTEGER, " +
+                            "author_key TEXT, " +
+                            "album_key TEXT, " +
+                            "genre_key TEXT, " +
+                            "creator_key TEXT, " +
                             "object_fk TEXT UNIQUE CONSTRAINT " +
                                 "object_fk_id REFERENCES Object(upnp_id) " +
                                     "ON DELETE CASCADE);";
@@ -228,9 +351,22 @@ internal class Rygel.MediaExport.SQLFactory : Object {
     private const string CREATE_IGNORELIST_TABLE_STRING =
     "CREATE TABLE ignorelist (uri TEXT, timestamp INTEGER NOT NULL);";
 
+    /**
+     * File system identity of harvested files, used to recognize a file
+     * after it was moved or renamed.
+     */
+    private const string CREATE_FILE_IDENTITY_TABLE_STRING =
+    "CREATE TABLE file_identity (uri TEXT PRIMARY KEY, " +
+                                "device INTEGER NOT NULL, " +
+                                "inode INTEGER NOT NULL, " +
+                                "size INTEGER NOT NULL, " +
+                                "mtime INTEGER NOT NULL);";
+
     private const string SCHEMA_STRING =
     "CREATE TABLE schema_info (version TEXT NOT NULL, " +
-                              "reset_token TEXT); " +
+                              "reset_token TEXT, " +
+                              "collation TEXT, " +
+                              "hierarchy TEXT); " +
     CREATE_META_DATA_TABLE_STRING +
     "CREATE TABLE object (parent TEXT CONSTRAINT parent_fk_id " +
                                 "REFERENCES Object(upnp_id), " +
@@ -243,8 +379,12 @@ internal class Rygel.MediaExport.SQLFactory : Object {
                           "deleted_child_count INTEGER, " +
                           "container_update_id INTEGER, " +
                           "is_guarded INTEGER, " +
-                          "reference_id TEXT DEFAULT NULL);" +
+                          "reference_id TEXT DEFAULT NULL, " +
+                          "title_key TEXT);" +
     CREATE_IGNORELIST_TABLE_STRING +
+    CREATE_FILE_IDENTITY_TABLE_STRING +
+    CREATE_AGGREGATE_TABLE_STRING +
+    CREATE_SIDECAR_TABLE_STRING +
     "INSERT INTO schema_info (version) VALUES ('" +
     SQLFactory.SCHEMA_VERSION + "'); ";
 
@@ -272,6 +412,88 @@ internal class Rygel.MediaExport.SQLFactory : Object {
         "DELETE FROM Closure WHERE descendant = OLD.upnp_id;" +
     "END;";
 
+    private const string FILL_CLOSURE_STRING =
+    "WITH RECURSIVE tree (ancestor, descendant, depth) AS (" +
+        "SELECT upnp_id, upnp_id, 0 FROM Object " +
+        "UNION ALL " +
+        "SELECT t.ancestor, o.upnp_id, t.depth + 1 FROM tree t " +
+            "JOIN Object o ON o.parent = t.descendant) " +
+    "INSERT INTO Closure (ancestor, descendant, depth) " +
+        "SELECT ancestor, descendant, depth FROM tree;";
+
+    private const string DROP_CLOSURE_STRING =
+    "DROP TRIGGER IF EXISTS trgr_update_closure;" +
+    "DROP TRIGGER IF EXISTS trgr_delete_closure;" +
+    "DROP TABLE IF EXISTS Closure;";
+
+    // The number of an object never changes, so moving an object only
+    // changes the paths of its sub-tree. Numbers are not re-used, as the
+    // paths of orphaned objects may still contain them
+    private const string CREATE_PATH_TABLE_STRING =
+    "CREATE TABLE object_path (id INTEGER PRIMARY KEY AUTOINCREMENT, " +
+                              "upnp_id TEXT UNIQUE NOT NULL, " +
+                              "path TEXT NOT NULL)";
+
+    private const string OLD_PATH_STRING =
+    "(SELECT path FROM object_path WHERE upnp_id = NEW.upnp_id)";
+
+    private const string NEW_PATH_STRING =
+    "COALESCE((SELECT path FROM object_path WHERE upnp_id = NEW.parent), " +
+             "'') || " +
+    "(SELECT id FROM object_path WHERE upnp_id = NEW.upnp_id) || '/'";
+
+    // A new object is numbered first and gets its path afterwards. Saving an
+    // existing object with a different parent moves its whole sub-tree.
+    // Objects are saved with INSERT OR REPLACE, which would override an
+    // OR IGNORE here and renumber the object
+    private const string CREATE_PATH_TRIGGER_STRING =
+    "CREATE TRIGGER trgr_update_path " +
+    "AFTER INSERT ON Object " +
+    "FOR EACH ROW BEGIN " +
+        "INSERT INTO object_path (upnp_id, path) " +
+            "SELECT NEW.upnp_id, '' WHERE NOT EXISTS " +
+                "(SELECT 1 FROM object_path WHERE upnp_id = NEW.upnp_id); " +
+        "UPDATE object_path SET path = " + NEW_PATH_STRING + " || " +
+            "substr(path, length(" + OLD_PATH_STRING + ") + 1) " +
+            "WHERE " + OLD_PATH_STRING + " != '' AND " +
+                  "path >= " + OLD_PATH_STRING + " AND " +
+                  "path < rtrim(" + OLD_PATH_STRING + ", '/') || '0' AND " +
+                  OLD_PATH_STRING + " != " + NEW_PATH_STRING + "; " +
+        "UPDATE object_path SET path = " + NEW_PATH_STRING + " " +
+            "WHERE upnp_id = NEW.upnp_id AND path = ''; " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_delete_path " +
+    "AFTER DELETE ON Object " +
+    "FOR EACH ROW BEGIN " +
+        "DELETE FROM object_path WHERE upnp_id = OLD.upnp_id;" +
+    "END;";
+
+    // Objects without an existing parent start a tree of their own, as they
+    // do in the closure table. The objects are numbered by their row in
+    // Object, which is unique as well
+    private const string FILL_PATH_STRING =
+    "WITH RECURSIVE tree (id, upnp_id, path) AS (" +
+        "SELECT rowid, upnp_id, rowid || '/' FROM Object " +
+            "WHERE parent IS NULL OR " +
+                  "parent NOT IN (SELECT upnp_id FROM Object) " +
+        "UNION ALL " +
+        "SELECT o.rowid, o.upnp_id, t.path || o.rowid || '/' FROM tree t " +
+            "JOIN Object o ON o.parent = t.upnp_id) " +
+    "INSERT INTO object_path (id, upnp_id, path) " +
+        "SELECT id, upnp_id, path FROM tree;";
+
+    private const string DROP_PATH_STRING =
+    "DROP TRIGGER IF EXISTS trgr_update_path;" +
+    "DROP TRIGGER IF EXISTS trgr_delete_path;" +
+    "DROP TABLE IF EXISTS object_path;";
+
+    private const string GET_HIERARCHY_STRING =
+    "SELECT hierarchy FROM schema_info";
+
+    private const string SET_HIERARCHY_STRING =
+    "UPDATE schema_info SET hierarchy = ?";
+
     // these triggers emulate ON DELETE CASCADE
     private const string CREATE_TRIGGER_STRING =
     "CREATE TRIGGER trgr_delete_metadata " +
@@ -287,27 +509,347 @@ internal class Rygel.MediaExport.SQLFactory : Object {
         "DELETE FROM Object WHERE OLD.upnp_id = Object.reference_id; " +
     "END;";
 
+    // References share the URI with their original, so only the original
+    // owns the identity
+    private const string DELETE_FILE_IDENTITY_TRIGGER_STRING =
+    "CREATE TRIGGER trgr_delete_file_identity " +
+    "AFTER DELETE ON Object " +
+    "FOR EACH ROW WHEN OLD.reference_id IS NULL BEGIN " +
+        "DELETE FROM file_identity WHERE file_identity.uri = OLD.uri; " +
+    "END;";
+
+    /**
+     * Trigram indices over the text columns used in contains/doesNotContain
+     * searches.
+     *
+     * Titles are keyed by the rowid of the Object row, so containers are
+     * indexed as well; the other columns by the rowid of the object's
+     * meta_data row.
+     */
+    private const string CREATE_FULL_TEXT_INDEX_STRING =
+    "CREATE VIRTUAL TABLE title_fts USING fts5 " +
+        "(title, tokenize = 'trigram');" +
+    "CREATE VIRTUAL TABLE meta_data_fts USING fts5 " +
+        "(author, album, creator, genre, tokenize = 'trigram');";
+
+    // REPLACE does not fire DELETE triggers and may hand out a new rowid,
+    // hence the explicit clean-up before inserting. The inserts inside the
+    // triggers take over the OR REPLACE of the outer statement.
+    private const string CREATE_FULL_TEXT_INDEX_TRIGGER_STRING =
+    "CREATE TRIGGER trgr_fts_replace_meta_data " +
+    "BEFORE INSERT ON meta_data " +
+    "FOR EACH ROW BEGIN " +
+        "DELETE FROM meta_data_fts WHERE rowid IN " +
+            "(SELECT rowid FROM meta_data WHERE object_fk = NEW.object_fk); " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_fts_insert_meta_data " +
+    "AFTER INSERT ON meta_data " +
+    "FOR EACH ROW BEGIN " +
+        "INSERT INTO meta_data_fts " +
+            "(rowid, author, album, creator, genre) VALUES " +
+            "(NEW.rowid, NEW.author, NEW.album, NEW.creator, NEW.genre); " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_fts_delete_meta_data " +
+    "AFTER DELETE ON meta_data " +
+    "FOR EACH ROW BEGIN " +
+        "DELETE FROM meta_data_fts WHERE rowid = OLD.rowid; " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_fts_replace_object " +
+    "BEFORE INSERT ON Object " +
+    "FOR EACH ROW BEGIN " +
+        "DELETE FROM title_fts WHERE rowid IN " +
+            "(SELECT rowid FROM Object WHERE upnp_id = NEW.upnp_id); " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_fts_insert_object " +
+    "AFTER INSERT ON Object " +
+    "FOR EACH ROW BEGIN " +
+        "INSERT INTO title_fts (rowid, title) VALUES (NEW.rowid, NEW.title); " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_fts_delete_object " +
+    "AFTER DELETE ON Object " +
+    "FOR EACH ROW BEGIN " +
+        "DELETE FROM title_fts WHERE rowid = OLD.rowid; " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_fts_update_object " +
+    "AFTER UPDATE OF title ON Object " +
+    "FOR EACH ROW BEGIN " +
+        "UPDATE title_fts SET title = NEW.title WHERE rowid = NEW.rowid; " +
+    "END;";
+
+    private const string FILL_FULL_TEXT_INDEX_STRING =
+    "INSERT INTO title_fts (rowid, title) SELECT rowid, title FROM Object;" +
+    "INSERT INTO meta_data_fts (rowid, author, album, creator, genre) " +
+        "SELECT rowid, author, album, creator, genre FROM meta_data;";
+
+    // Also removes the single object_fts table of earlier versions
+    private const string DROP_FULL_TEXT_INDEX_STRING =
+    "DROP TRIGGER IF EXISTS trgr_fts_replace_meta_data;" +
+    "DROP TRIGGER IF EXISTS trgr_fts_insert_meta_data;" +
+    "DROP TRIGGER IF EXISTS trgr_fts_delete_meta_data;" +
+    "DROP TRIGGER IF EXISTS trgr_fts_replace_object;" +
+    "DROP TRIGGER IF EXISTS trgr_fts_insert_object;" +
+    "DROP TRIGGER IF EXISTS trgr_fts_delete_object;" +
+    "DROP TRIGGER IF EXISTS trgr_fts_update_object;" +
+    "DROP TABLE IF EXISTS object_fts;" +
+    "DROP TABLE IF EXISTS title_fts;" +
+    "DROP TABLE IF EXISTS meta_data_fts;";
+
+    private const string HAS_FULL_TEXT_INDEX_STRING =
+    "SELECT count(*) FROM sqlite_master " +
+        "WHERE type = 'table' AND name IN ('title_fts', 'meta_data_fts')";
+
+    /**
+     * Number of items per (attribute, class, value) for the virtual folders.
+     *
+     * Rows are not removed when their count drops to zero, this is done on
+     * start-up.
+     */
+    private const string CREATE_AGGREGATE_TABLE_STRING =
+    "CREATE TABLE meta_data_aggregate (attribute TEXT NOT NULL, " +
+                                      "value TEXT NOT NULL, " +
+                                      "class TEXT NOT NULL, " +
+                                      "value_key TEXT, " +
+                                      "count INTEGER NOT NULL, " +
+                                      "PRIMARY KEY (attribute, value, class));";
+
+    /**
+     * Results of the look-ups for album art and subtitles, see
+     * Rygel.SidecarCache.
+     */
+    private const string CREATE_SIDECAR_TABLE_STRING =
+    "CREATE TABLE sidecar (grp TEXT NOT NULL, " +
+                          "name TEXT NOT NULL, " +
+                          "value TEXT NOT NULL, " +
+                          "PRIMARY KEY (grp, name));";
+
+    private const string GET_SIDECAR_STRING =
+    "SELECT value FROM sidecar WHERE grp = ? AND name = ?";
+
+    private const string SAVE_SIDECAR_STRING =
+    "INSERT OR REPLACE INTO sidecar (grp, name, value) VALUES (?,?,?)";
+
+    private const string DELETE_SIDECAR_STRING =
+    "DELETE FROM sidecar WHERE grp = ?";
+
+    // As with the full-text index, REPLACE needs the explicit clean-up
+    // before the insert
+    private const string CREATE_AGGREGATE_TRIGGER_STRING =
+    "CREATE TRIGGER trgr_aggregate_replace_meta_data " +
+    "BEFORE INSERT ON meta_data " +
+    "FOR EACH ROW BEGIN " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'author' AND " +
+            "value = (SELECT author FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk) AND " +
+            "class = (SELECT class FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk); " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'album' AND " +
+            "value = (SELECT album FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk) AND " +
+            "class = (SELECT class FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk); " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'genre' AND " +
+            "value = (SELECT genre FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk) AND " +
+            "class = (SELECT class FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk); " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'creator' AND " +
+            "value = (SELECT creator FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk) AND " +
+            "class = (SELECT class FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk); " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'year' AND " +
+            "value = (SELECT strftime('%Y', date) FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk) AND " +
+            "class = (SELECT class FROM meta_data " +
+                     "WHERE object_fk = NEW.object_fk); " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_aggregate_insert_meta_data " +
+    "AFTER INSERT ON meta_data " +
+    "FOR EACH ROW BEGIN " +
+        "INSERT OR IGNORE INTO meta_data_aggregate " +
+            "(attribute, value, class, value_key, count) " +
+            "SELECT 'author', NEW.author, NEW.class, NEW.author_key, 0 " +
+            "WHERE NEW.author IS NOT NULL; " +
+        "UPDATE meta_data_aggregate SET count = count + 1 " +
+            "WHERE attribute = 'author' AND value = NEW.author " +
+            "AND class = NEW.class; " +
+        "INSERT OR IGNORE INTO meta_data_aggregate " +
+            "(attribute, value, class, value_key, count) " +
+            "SELECT 'album', NEW.album, NEW.class, NEW.album_key, 0 " +
+            "WHERE NEW.album IS NOT NULL; " +
+        "UPDATE meta_data_aggregate SET count = count + 1 " +
+            "WHERE attribute = 'album' AND value = NEW.album " +
+            "AND class = NEW.class; " +
+        "INSERT OR IGNORE INTO meta_data_aggregate " +
+            "(attribute, value, class, value_key, count) " +
+            "SELECT 'genre', NEW.genre, NEW.class, NEW.genre_key, 0 " +
+            "WHERE NEW.genre IS NOT NULL; " +
+        "UPDATE meta_data_aggregate SET count = count + 1 " +
+            "WHERE attribute = 'genre' AND value = NEW.genre " +
+            "AND class = NEW.class; " +
+        "INSERT OR IGNORE INTO meta_data_aggregate " +
+            "(attribute, value, class, value_key, count) " +
+            "SELECT 'creator', NEW.creator, NEW.class, NEW.creator_key, 0 " +
+            "WHERE NEW.creator IS NOT NULL; " +
+        "UPDATE meta_data_aggregate SET count = count + 1 " +
+            "WHERE attribute = 'creator' AND value = NEW.creator " +
+            "AND class = NEW.class; " +
+        "INSERT OR IGNORE INTO meta_data_aggregate " +
+            "(attribute, value, class, value_key, count) " +
+            "SELECT 'year', strftime('%Y', NEW.date), NEW.class, " +
+                   "strftime('%Y', NEW.date), 0 " +
+            "WHERE strftime('%Y', NEW.date) IS NOT NULL; " +
+        "UPDATE meta_data_aggregate SET count = count + 1 " +
+            "WHERE attribute = 'year' AND value = strftime('%Y', NEW.date) " +
+            "AND class = NEW.class; " +
+    "END;" +
+
+    "CREATE TRIGGER trgr_aggregate_delete_meta_data " +
+    "AFTER DELETE ON meta_data " +
+    "FOR EACH ROW BEGIN " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'author' AND value = OLD.author " +
+            "AND class = OLD.class; " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'album' AND value = OLD.album " +
+            "AND class = OLD.class; " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'genre' AND value = OLD.genre " +
+            "AND class = OLD.class; " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'creator' AND value = OLD.creator " +
+            "AND class = OLD.class; " +
+        "UPDATE meta_data_aggregate SET count = count - 1 " +
+            "WHERE attribute = 'year' AND value = strftime('%Y', OLD.date) " +
+            "AND class = OLD.class; " +
+    "END;";
+
+    private const string FILL_AGGREGATE_STRING =
+    "INSERT INTO meta_data_aggregate " +
+        "(attribute, value, class, value_key, count) " +
+        "SELECT 'author', author, class, author_key, count(*) " +
+        "FROM meta_data " +
+        "WHERE author IS NOT NULL GROUP BY author, class; " +
+    "INSERT INTO meta_data_aggregate " +
+        "(attribute, value, class, value_key, count) " +
+        "SELECT 'album', album, class, album_key, count(*) " +
+        "FROM meta_data " +
+        "WHERE album IS NOT NULL GROUP BY album, class; " +
+    "INSERT INTO meta_data_aggregate " +
+        "(attribute, value, class, value_key, count) " +
+        "SELECT 'genre', genre, class, genre_key, count(*) " +
+        "FROM meta_data " +
+        "WHERE genre IS NOT NULL GROUP BY genre, class; " +
+    "INSERT INTO meta_data_aggregate " +
+        "(attribute, value, class, value_key, count) " +
+        "SELECT 'creator', creator, class, creator_key, count(*) " +
+        "FROM meta_data " +
+        "WHERE creator IS NOT NULL GROUP BY creator, class; " +
+    "INSERT INTO meta_data_aggregate " +
+        "(attribute, value, class, value_key, count) " +
+        "SELECT 'year', strftime('%Y', date), class, " +
+               "strftime('%Y', date), count(*) " +
+        "FROM meta_data WHERE strftime('%Y', date) IS NOT NULL " +
+        "GROUP BY strftime('%Y', date), class;";
+
+    private const string PRUNE_AGGREGATE_STRING =
+    "DELETE FROM meta_data_aggregate WHERE count <= 0";
+
+    private const string GET_AGGREGATE_VALUES_STRING =
+    "SELECT value FROM meta_data_aggregate " +
+        "WHERE attribute = ? AND class = ? AND count > 0 " +
+        "ORDER BY value_key %s " +
+    "LIMIT ?,?";
+
+    private const string GET_AGGREGATE_COUNT_STRING =
+    "SELECT count(*) FROM meta_data_aggregate " +
+        "WHERE attribute = ? AND class = ? AND count > 0";
+
     private const string CREATE_INDICES_STRING =
     "CREATE INDEX IF NOT EXISTS idx_parent on Object(parent);" +
     "CREATE INDEX IF NOT EXISTS idx_object_upnp_id on Object(upnp_id);" +
     "CREATE INDEX IF NOT EXISTS idx_meta_data_fk on meta_data(object_fk);" +
-    "CREATE INDEX IF NOT EXISTS idx_closure on Closure(descendant,depth);" +
-    "CREATE INDEX IF NOT EXISTS idx_closure_descendant on Closure(descendant);" +
-    "CREATE INDEX IF NOT EXISTS idx_closure_ancestor on Closure(ancestor);" +
     "CREATE INDEX IF NOT EXISTS idx_uri on Object(uri);" +
     "CREATE INDEX IF NOT EXISTS idx_meta_data_date on meta_data(date);" +
     "CREATE INDEX IF NOT EXISTS idx_meta_data_genre on meta_data(genre);" +
     "CREATE INDEX IF NOT EXISTS idx_meta_data_album on meta_data(album);" +
     "CREATE INDEX IF NOT EXISTS idx_meta_data_artist_album on " +
                                 "meta_data(author, album);" +
+    "CREATE INDEX IF NOT EXISTS idx_object_title_key on Object(title_key);" +
+    "CREATE INDEX IF NOT EXISTS idx_meta_data_author_key on " +
+                                "meta_data(author_key);" +
+    "CREATE INDEX IF NOT EXISTS idx_meta_data_album_key on " +
+                                "meta_data(album_key);" +
+    "CREATE INDEX IF NOT EXISTS idx_meta_data_genre_key on " +
+                                "meta_data(genre_key);" +
+    "CREATE INDEX IF NOT EXISTS idx_meta_data_creator_key on " +
+                                "meta_data(creator_key);" +
+    "CREATE INDEX IF NOT EXISTS idx_meta_data_aggregate_key on " +
+                                "meta_data_aggregate(attribute, class, " +
+                                                    "value_key);" +
+    "CREATE INDEX IF NOT EXISTS idx_file_identity_inode on " +
+                                "file_identity(inode);" +
     CREATE_IGNORELIST_INDEX_STRING;
 
+    private const string CREATE_CLOSURE_INDICES_STRING =
+    CREATE_INDICES_STRING +
+    "CREATE INDEX IF NOT EXISTS idx_closure on Closure(descendant,depth);" +
+    "CREATE INDEX IF NOT EXISTS idx_closure_descendant on Closure(descendant);" +
+    "CREATE INDEX IF NOT EXISTS idx_closure_ancestor on Closure(ancestor);";
+
+    private const string CREATE_PATH_INDICES_STRING =
+    CREATE_INDICES_STRING +
+    "CREATE INDEX IF NOT EXISTS idx_object_path on object_path(path);";
+
     private const string CREATE_IGNORELIST_INDEX_STRING =
     "CREATE INDEX IF NOT EXISTS idx_ignorelist on ignorelist(uri);";
 
     private const string EXISTS_CACHE_STRING =
-    "SELECT m.size, o.timestamp, m.mime_type, o.uri FROM Object o " +
-        "JOIN meta_data m ON o.upnp_id = m.object_fk";
+    "SELECT m.size, o.timestamp, m.mime_type, o.uri, f.inode " +
+    "FROM Object o " +
+        "JOIN meta_data m ON o.upnp_id = m.object_fk " +
+        "LEFT OUTER JOIN file_identity f ON f.uri = o.uri";
+
+    private const string SAVE_FILE_IDENTITY_STRING =
+    "INSERT OR REPLACE INTO file_identity " +
+        "(uri, device, inode, size, mtime) VALUES (?,?,?,?,?)";
+
+    private const string FIND_BY_FILE_IDENTITY_STRING =
+    "SELECT f.uri FROM file_identity f " +
+        "JOIN Object o ON o.uri = f.uri AND o.reference_id IS NULL " +
+        "WHERE f.inode = ? AND f.device = ? AND f.size = ? AND " +
+              "f.mtime = ? AND f.uri != ?";
+
+    private const string GET_COLLATION_STRING =
+    "SELECT collation FROM schema_info";
+
+    private const string SET_COLLATION_STRING =
+    "UPDATE schema_info SET collation = ?";
+
+    /**
+     * Collation keys depend on the locale, so they need to be re-computed if
+     * it changes
+     */
+    private const string UPDATE_COLLATION_KEYS_STRING =
+    "UPDATE Object SET title_key = collate_key(title);" +
+    "UPDATE meta_data SET author_key = collate_key(author), " +
+                         "album_key = collate_key(album), " +
+                         "genre_key = collate_key(genre), " +
+                         "creator_key = collate_key(creator);" +
+    "UPDATE meta_data_aggregate SET value_key = collate_key(value) " +
+        "WHERE attribute != 'year';";
 
     private const string STATISTICS_STRING =
     "SELECT class, count(1) FROM meta_data GROUP BY class";
@@ -324,25 +866,72 @@ internal class Rygel.MediaExport.SQLFactory : Object {
     private const string IS_GUARDED_STRING =
     "SELECT is_guarded FROM Object WHERE Object.upnp_id = ?";
 
+    /**
+     * Prefix all SQL returned by make () with a comment naming the
+     * SQLString it was made from.
+     *
+     * Database.Profile uses this to group the statements by template.
+     */
+    public void label_queries () {
+        this.labelled = new HashTable<string, string> (str_hash, str_equal);
+    }
+
     public unowned string make (SQLString query) {
+        unowned string sql = this.get_sql (query);
+        if (this.labelled == null) {
+            return sql;
+        }
+
+        unowned string labelled = this.labelled.lookup (sql);
+        if (labelled == null) {
+            var name = query.to_string ().replace ("RYGEL_MEDIA_EXPORT_SQL_STRING_",
+                                                   "");
+            this.labelled.insert (sql, "/* %s */ %s".printf (name, sql));
+            labelled = this.labelled.lookup (sql);
+        }
+
+        return labelled;
+    }
+
+    private unowned string get_sql (SQLString query) {
         switch (query) {
             case SQLString.SAVE_METADATA:
                 return SAVE_META_DATA_STRING;
             case SQLString.INSERT:
                 return INSERT_OBJECT_STRING;
             case SQLString.DELETE:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return DELETE_BY_ID_BY_PATH_STRING;
+                }
+
                 return DELETE_BY_ID_STRING;
             case SQLString.GET_OBJECT:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return GET_OBJECT_WITH_ANCESTORS;
+                }
+
                 return GET_OBJECT_WITH_PATH;
             case SQLString.GET_CHILDREN:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return GET_CHILDREN_BY_PARENT_STRING;
+                }
+
                 return GET_CHILDREN_STRING;
             case SQLString.GET_OBJECTS_BY_FILTER:
                 return GET_OBJECTS_BY_FILTER_STRING;
             case SQLString.GET_OBJECTS_BY_FILTER_WITH_ANCESTOR:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return GET_OBJECTS_BY_FILTER_STRING_BY_PATH;
+                }
+
                 return GET_OBJECTS_BY_FILTER_STRING_WITH_ANCESTOR;
             case SQLString.GET_OBJECT_COUNT_BY_FILTER:
                 return GET_OBJECT_COUNT_BY_FILTER_STRING;
             case SQLString.GET_OBJECT_COUNT_BY_FILTER_WITH_ANCESTOR:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return GET_OBJECT_COUNT_BY_FILTER_STRING_BY_PATH;
+                }
+
                 return GET_OBJECT_COUNT_BY_FILTER_STRING_WITH_ANCESTOR;
             case SQLString.GET_META_DATA_COLUMN:
                 return GET_META_DATA_COLUMN_STRING;
@@ -356,16 +945,44 @@ internal class Rygel.MediaExport.SQLFactory : Object {
                 return CREATE_META_DATA_TABLE_STRING;
             case SQLString.TRIGGER_COMMON:
                 return CREATE_TRIGGER_STRING;
-            case SQLString.TRIGGER_CLOSURE:
+            case SQLString.TRIGGER_HIERARCHY:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return CREATE_PATH_TRIGGER_STRING;
+                }
+
                 return CREATE_CLOSURE_TRIGGER_STRING;
             case SQLString.INDEX_COMMON:
-                return CREATE_INDICES_STRING;
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return CREATE_PATH_INDICES_STRING;
+                }
+
+                return CREATE_CLOSURE_INDICES_STRING;
             case SQLString.SCHEMA:
                 return SCHEMA_STRING;
             case SQLString.EXISTS_CACHE:
                 return EXISTS_CACHE_STRING;
-            case SQLString.TABLE_CLOSURE:
+            case SQLString.TABLE_HIERARCHY:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return CREATE_PATH_TABLE_STRING;
+                }
+
                 return CREATE_CLOSURE_TABLE;
+            case SQLString.FILL_HIERARCHY:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return FILL_PATH_STRING;
+                }
+
+                return FILL_CLOSURE_STRING;
+            case SQLString.DROP_HIERARCHY:
+                if (this.hierarchy == Hierarchy.PATH) {
+                    return DROP_PATH_STRING;
+                }
+
+                return DROP_CLOSURE_STRING;
+            case SQLString.GET_HIERARCHY:
+                return GET_HIERARCHY_STRING;
+            case SQLString.SET_HIERARCHY:
+                return SET_HIERARCHY_STRING;
             case SQLString.STATISTICS:
                 return STATISTICS_STRING;
             case SQLString.RESET_TOKEN:
@@ -388,6 +1005,50 @@ internal class Rygel.MediaExport.SQLFactory : Object {
                 return ADD_TO_IGNORELIST_STRING;
             case SQLString.CHECK_IGNORELIST:
                 return CHECK_IGNORELIST_STRING;
+            case SQLString.TABLE_FILE_IDENTITY:
+                return CREATE_FILE_IDENTITY_TABLE_STRING;
+            case SQLString.TRIGGER_FILE_IDENTITY:
+                return DELETE_FILE_IDENTITY_TRIGGER_STRING;
+            case SQLString.SAVE_FILE_IDENTITY:
+                return SAVE_FILE_IDENTITY_STRING;
+            case SQLString.FIND_BY_FILE_IDENTITY:
+                return FIND_BY_FILE_IDENTITY_STRING;
+            case SQLString.TABLE_FULL_TEXT_INDEX:
+                return CREATE_FULL_TEXT_INDEX_STRING;
+            case SQLString.TRIGGER_FULL_TEXT_INDEX:
+                return CREATE_FULL_TEXT_INDEX_TRIGGER_STRING;
+            case SQLString.FILL_FULL_TEXT_INDEX:
+                return FILL_FULL_TEXT_INDEX_STRING;
+            case SQLString.DROP_FULL_TEXT_INDEX:
+                return DROP_FULL_TEXT_INDEX_STRING;
+            case SQLString.HAS_FULL_TEXT_INDEX:
+                return HAS_FULL_TEXT_INDEX_STRING;
+            case SQLString.GET_COLLATION:
+                return GET_COLLATION_STRING;
+            case SQLString.SET_COLLATION:
+                return SET_COLLATION_STRING;
+            case SQLString.UPDATE_COLLATION_KEYS:
+                return UPDATE_COLLATION_KEYS_STRING;
+            case SQLString.TABLE_AGGREGATE:
+                return CREATE_AGGREGATE_TABLE_STRING;
+            case SQLString.TRIGGER_AGGREGATE:
+                return CREATE_AGGREGATE_TRIGGER_STRING;
+            case SQLString.FILL_AGGREGATE:
+                return FILL_AGGREGATE_STRING;
+            case SQLString.PRUNE_AGGREGATE:
+                return PRUNE_AGGREGATE_STRING;
+            case SQLString.GET_AGGREGATE_VALUES:
+                return GET_AGGREGATE_VALUES_STRING;
+            case SQLString.GET_AGGREGATE_COUNT:
+                return GET_AGGREGATE_COUNT_STRING;
+            case SQLString.TABLE_SIDECAR:
+                return CREATE_SIDECAR_TABLE_STRING;
+            case SQLString.GET_SIDECAR:
+                return GET_SIDECAR_STRING;
+            case SQLString.SAVE_SIDECAR:
+                return SAVE_SIDECAR_STRING;
+            case SQLString.DELETE_SIDECAR:
+                return DELETE_SIDECAR_STRING;
             default:
                 assert_not_reached ();
         }
@@ -26,9 +26,12 @@ internal class Rygel.DBusService : Object, DBusInterface {
     private Application main;
     private uint name_id;
     private uint connection_id;
+    private uint statistics_id;
+    private DBusStatisticsService statistics;
 
     public DBusService (Application main) {
         this.main = main;
+        this.statistics = new DBusStatisticsService ();
     }
 
     public void shutdown () throws IOError, DBusError {
@@ -48,6 +51,9 @@ internal class Rygel.DBusService : Object, DBusInterface {
             try {
                 var connection = Bus.get_sync (BusType.SESSION);
                 connection.unregister_object (this.connection_id);
+                if (this.statistics_id != 0) {
+                    connection.unregister_object (this.statistics_id);
+                }
             } catch (IOError error) {};
         }
 
@@ -63,6 +69,15 @@ internal class Rygel.DBusService : Object, DBusInterface {
         } catch (IOError e) {
             debug ("Failed to register legacy interface on connection: %s", e.message);
         }
+
+        try {
+            this.statistics_id = connection.register_object
+                                        (DBusInterface.OBJECT_PATH,
+                                         (DBusStatistics) this.statistics);
+        } catch (IOError e) {
+            debug ("Failed to register statistics interface on connection: %s",
+                   e.message);
+        }
     }
 
     private void on_name_lost (DBusConnection? connection) {
@@ -0,0 +1,876 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+
+const string CONTENT_DIRECTORY =
+                    "urn:schemas-upnp-org:service:ContentDirectory:3";
+const string CONTROL_PATH = "/Control/MediaExport/RygelContentDirectory";
+const string ENGINE = "librygel-media-engine-simple.so";
+
+const int TRACKS_PER_ALBUM = 10;
+const int ALBUMS_PER_ARTIST = 5;
+// Every tenth file of the library is a video
+const int VIDEO_INTERVAL = 10;
+const int PAGE_SIZE = 50;
+const int READ_SIZE = 64 * 1024;
+
+static string rygel_path;
+static string plugin_path;
+static string engine_path;
+static int items = 2000;
+static int file_size = 16;
+static int streams = 4;
+static int stream_size = 8;
+static int clients = 4;
+static int rounds = 10;
+static int requests = 32;
+static int range_size = 256;
+static int port = 0;
+static int harvest_timeout = 300;
+static bool keep = false;
+
+const OptionEntry[] options = {
+    { "rygel", 0, 0, OptionArg.FILENAME, ref rygel_path,
+      "Rygel daemon to run", "PATH" },
+    { "plugin-path", 0, 0, OptionArg.FILENAME, ref plugin_path,
+      "Directory of the MediaExport plugin", "PATH" },
+    { "engine-path", 0, 0, OptionArg.FILENAME, ref engine_path,
+      "Directory of the simple media engine", "PATH" },
+    { "items", 0, 0, OptionArg.INT, ref items,
+      "Number of files in the library", "N" },
+    { "file-size", 0, 0, OptionArg.INT, ref file_size,
+      "Size of the files in the library in KiB", "KIB" },
+    { "streams", 0, 0, OptionArg.INT, ref streams,
+      "Number of files to stream from", "N" },
+    { "stream-size", 0, 0, OptionArg.INT, ref stream_size,
+      "Size of the files to stream from in MiB", "MIB" },
+    { "clients", 0, 0, OptionArg.INT, ref clients,
+      "Number of concurrent clients", "N" },
+    { "rounds", 0, 0, OptionArg.INT, ref rounds,
+      "Number of rounds of searches per client", "N" },
+    { "requests", 0, 0, OptionArg.INT, ref requests,
+      "Number of range requests per client", "N" },
+    { "range-size", 0, 0, OptionArg.INT, ref range_size,
+      "Size of the range requests in KiB", "KIB" },
+    { "port", 0, 0, OptionArg.INT, ref port,
+      "Port to run Rygel on, or 0 to pick a free one", "PORT" },
+    { "harvest-timeout", 0, 0, OptionArg.INT, ref harvest_timeout,
+      "Seconds to wait for the library to be harvested", "SECONDS" },
+    { "keep", 0, 0, OptionArg.NONE, ref keep,
+      "Keep the library and the database after the run", null },
+    { null }
+};
+
+public errordomain BenchmarkError {
+    FAILED,
+    TIMEOUT
+}
+
+/**
+ * CPU time and memory use of a process, from /proc.
+ */
+public class ProcessStats {
+    public int64 cpu;
+    public int64 rss;
+    public int64 peak_rss;
+
+    public ProcessStats (string pid) {
+        try {
+            string contents;
+            FileUtils.get_contents ("/proc/%s/stat".printf (pid), out contents);
+
+            // The command name may contain spaces; the fields after it start
+            // with the state, the third field
+            var start = contents.last_index_of_char (')') + 2;
+            var fields = contents.substring (start).split (" ");
+            var ticks = int64.parse (fields[11]) + int64.parse (fields[12]);
+            var hz = (int64) Posix.sysconf (Posix._SC_CLK_TCK);
+            this.cpu = ticks * TimeSpan.SECOND / hz;
+
+            FileUtils.get_contents ("/proc/%s/status".printf (pid),
+                                    out contents);
+            foreach (var line in contents.split ("\n")) {
+                if (line.has_prefix ("VmRSS:")) {
+                    this.rss = ProcessStats.parse_size (line);
+                } else if (line.has_prefix ("VmHWM:")) {
+                    this.peak_rss = ProcessStats.parse_size (line);
+                }
+            }
+        } catch (Error error) {
+            warning ("Failed to read statistics of %s: %s",
+                     pid,
+                     error.message);
+        }
+    }
+
+    // Lines look like "VmRSS:     1234 kB"
+    private static int64 parse_size (string line) {
+        var value = line.substring (line.index_of_char (':') + 1).strip ();
+
+        return int64.parse (value.split (" ")[0]) * 1024;
+    }
+}
+
+/**
+ * Requests of one kind and what they cost.
+ */
+public class Operation {
+    public string name;
+    public int64 bytes;
+    public int64 count;
+
+    private ArrayList<int64?> latencies;
+    private int64 start;
+    private int64 time;
+    private ProcessStats before;
+    private ProcessStats after;
+
+    public Operation (string name) {
+        this.name = name;
+        this.latencies = new ArrayList<int64?> ();
+    }
+
+    public void begin (string pid) {
+        this.before = new ProcessStats (pid);
+        this.start = get_monotonic_time ();
+    }
+
+    public void end (string pid) {
+        this.time = get_monotonic_time () - this.start;
+        this.after = new ProcessStats (pid);
+    }
+
+    /**
+     * Account a request which took @latency microseconds and returned
+     * @size bytes.
+     */
+    public void add (int64 latency, int64 size) {
+        this.latencies.add (latency);
+        this.bytes += size;
+        this.count++;
+    }
+
+    public static void print_header () {
+        print ("%-10s %8s %9s %9s %9s %9s %10s %9s %9s\n",
+               "operation",
+               "count",
+               "ops/s",
+               "p50 ms",
+               "p99 ms",
+               "MiB/s",
+               "cpu ms/op",
+               "rss MiB",
+               "peak MiB");
+    }
+
+    public void print_result () {
+        var seconds = this.time / (double) TimeSpan.SECOND;
+        var cpu = (this.after.cpu - this.before.cpu) / 1000.0;
+
+        this.latencies.sort ((a, b) => {
+            var first = (int64) a;
+            var second = (int64) b;
+
+            return first < second ? -1 : (first > second ? 1 : 0);
+        });
+
+        print ("%-10s %8s %9.1f %9s %9s %9.1f %10.3f %9.1f %9.1f\n",
+               this.name,
+               this.count.to_string (),
+               this.count / seconds,
+               this.format_percentile (0.5),
+               this.format_percentile (0.99),
+               this.bytes / seconds / (1024 * 1024),
+               this.count > 0 ? cpu / this.count : 0.0,
+               this.after.rss / (1024.0 * 1024),
+               this.after.peak_rss / (1024.0 * 1024));
+    }
+
+    // The nearest-rank percentile of the sorted latencies
+    private string format_percentile (double fraction) {
+        var size = this.latencies.size;
+        if (size == 0) {
+            return "-";
+        }
+
+        var rank = (int) (size * fraction);
+        if (rank < size * fraction) {
+            rank++;
+        }
+        var latency = (int64) this.latencies[int.max (rank - 1, 0)];
+
+        return "%.3f".printf (latency / 1000.0);
+    }
+}
+
+/**
+ * The reply to a Browse or Search action.
+ */
+public class SearchResult {
+    public string didl;
+    public uint returned;
+    public uint total;
+}
+
+/**
+ * Load test of the media server with MediaExport.
+ *
+ * The benchmark creates a synthetic library, runs the rygel daemon on it
+ * with the simple media engine and waits until MediaExport has harvested
+ * it. It then acts as a number of control points on the loopback interface,
+ * which browse all containers page by page, search and request byte ranges
+ * of large files concurrently. For each of these, it reports the throughput,
+ * the 50th and 99th percentile of the latencies and the CPU time and memory
+ * used by the daemon.
+ *
+ * The files have fixed contents and the requests are made in a fixed order,
+ * so runs on the same machine can be compared with each other. The daemon
+ * hands over to an instance already running on the same session bus, so the
+ * benchmark is best run on a bus of its own, using dbus-run-session.
+ */
+public class MediaServerBenchmark : Object {
+    private MainLoop loop;
+    private int status;
+    private string root;
+    private string library;
+    private string control_url;
+    private Subprocess daemon;
+    private string pid;
+    private bool exited;
+    // One for each client, so they have connections of their own
+    private ArrayList<Soup.Session> sessions;
+    private ArrayList<string> stream_uris;
+
+    public MediaServerBenchmark () {
+        this.loop = new MainLoop ();
+        this.status = 1;
+        this.stream_uris = new ArrayList<string> ();
+        this.sessions = new ArrayList<Soup.Session> ();
+        for (var i = 0; i < clients; i++) {
+            this.sessions.add (new Soup.Session ());
+        }
+    }
+
+    public int run () {
+        this.run_async.begin ();
+        this.loop.run ();
+
+        return this.status;
+    }
+
+    private async void run_async () {
+        try {
+            this.root = DirUtils.make_tmp ("rygel-benchmark-XXXXXX");
+            this.library = Path.build_filename (this.root, "library");
+            var expected = this.create_library ();
+
+            // Harvesting starts together with the daemon, so its start-up
+            // is accounted to it as well
+            var harvest = new Operation ("harvest");
+            this.start_daemon ();
+            harvest.begin (this.pid);
+            yield this.wait_for_daemon ();
+            yield this.wait_for_harvest (expected, harvest);
+            harvest.end (this.pid);
+
+            var browse = new Operation ("browse");
+            var search = new Operation ("search");
+            var range_get = new Operation ("range-get");
+
+            yield this.run_clients (browse);
+            yield this.find_streams ();
+            yield this.run_clients (search);
+            yield this.run_clients (range_get);
+
+            print ("\n%d files, %d clients, %d rounds, %d range requests " +
+                   "of %d KiB per client\n\n",
+                   expected,
+                   clients,
+                   rounds,
+                   requests,
+                   range_size);
+            Operation.print_header ();
+            harvest.print_result ();
+            browse.print_result ();
+            search.print_result ();
+            range_get.print_result ();
+
+            this.status = 0;
+        } catch (Error error) {
+            printerr ("Benchmark failed: %s\n", error.message);
+        }
+
+        yield this.stop_daemon ();
+
+        if (this.root != null && !keep) {
+            this.remove_recursively (File.new_for_path (this.root));
+        } else if (this.root != null) {
+            print ("\nLibrary and database kept in %s\n", this.root);
+        }
+
+        this.loop.quit ();
+    }
+
+    /**
+     * Create a library of albums with ten tracks each, a few videos and the
+     * large files streamed from.
+     *
+     * @return the number of files created
+     */
+    private int create_library () throws Error {
+        var audio = this.create_contents (file_size * 1024, "ID3\x04");
+        var video = this.create_contents (file_size * 1024, "ftypisom");
+
+        for (var i = 0; i < items; i++) {
+            string path;
+            if (i % VIDEO_INTERVAL == VIDEO_INTERVAL - 1) {
+                path = Path.build_filename (this.library,
+                                            "Videos",
+                                            "Clip %05d.mp4".printf (i));
+                this.create_file (path, video);
+            } else {
+                var album = i / TRACKS_PER_ALBUM;
+                path = Path.build_filename
+                                        (this.library,
+                                         "Artist %03d".printf
+                                                (album / ALBUMS_PER_ARTIST),
+                                         "Album %05d".printf (album),
+                                         "Track %05d.mp3".printf (i));
+                this.create_file (path, audio);
+            }
+        }
+
+        var stream = this.create_contents (stream_size * 1024 * 1024,
+                                           "ftypisom");
+        for (var i = 0; i < streams; i++) {
+            var path = Path.build_filename (this.library,
+                                            "Streams",
+                                            "Stream %d.mp4".printf (i));
+            this.create_file (path, stream);
+        }
+
+        return items + streams;
+    }
+
+    private uint8[] create_contents (int size, string magic) {
+        var contents = new uint8[size];
+        for (var i = 0; i < size; i++) {
+            contents[i] = (uint8) (i * 31 + i / 4096);
+        }
+
+        // Enough for the content type to be guessed from the data as well
+        if (magic.has_prefix ("ftyp")) {
+            contents[0] = contents[1] = contents[2] = 0;
+            contents[3] = 24;
+            Memory.copy ((uint8*) contents + 4, magic, magic.length);
+        } else {
+            Memory.copy (contents, magic, magic.length);
+        }
+
+        return contents;
+    }
+
+    private void create_file (string path, uint8[] contents) throws Error {
+        DirUtils.create_with_parents (Path.get_dirname (path), 0755);
+        FileUtils.set_data (path, contents);
+    }
+
+    private void remove_recursively (File file) {
+        try {
+            var children = file.enumerate_children
+                                        (FileAttribute.STANDARD_NAME,
+                                         FileQueryInfoFlags.NOFOLLOW_SYMLINKS);
+            FileInfo info;
+            while ((info = children.next_file ()) != null) {
+                this.remove_recursively (file.get_child (info.get_name ()));
+            }
+        } catch (Error error) { }
+
+        try {
+            file.delete ();
+        } catch (Error error) {
+            warning ("Failed to remove %s: %s",
+                     file.get_path (),
+                     error.message);
+        }
+    }
+
+    private uint16 find_free_port () throws Error {
+        var socket = new Socket (SocketFamily.IPV4,
+                                 SocketType.STREAM,
+                                 SocketProtocol.TCP);
+        var address = new InetSocketAddress
+                                        (new InetAddress.loopback
+                                                (SocketFamily.IPV4),
+                                         0);
+        socket.bind (address, false);
+        var local = (InetSocketAddress) socket.get_local_address ();
+        socket.close ();
+
+        return local.get_port ();
+    }
+
+    private void start_daemon () throws Error {
+        if (rygel_path == null) {
+            throw new BenchmarkError.FAILED ("No Rygel daemon given");
+        }
+
+        var server_port = port > 0 ? (uint16) port : this.find_free_port ();
+        this.control_url = "http://127.0.0.1:%u%s".printf (server_port,
+                                                           CONTROL_PATH);
+
+        var config = new KeyFile ();
+        config.set_boolean ("general", "ipv6", false);
+        config.set_string ("general", "interface", "lo");
+        config.set_integer ("general", "port", server_port);
+        config.set_string ("general", "media-engine", ENGINE);
+        config.set_boolean ("general", "enable-transcoding", false);
+        config.set_boolean ("MediaExport", "enabled", true);
+        config.set_string ("MediaExport",
+                           "uris",
+                           File.new_for_path (this.library).get_uri ());
+        config.set_boolean ("MediaExport", "extract-metadata", false);
+        config.set_boolean ("MediaExport", "monitor-changes", false);
+        var config_path = Path.build_filename (this.root, "rygel.conf");
+        config.save_to_file (config_path);
+
+        // Keep the database, media art and everything else out of the home
+        // directory of the user
+        var launcher = new SubprocessLauncher (SubprocessFlags.NONE);
+        foreach (var name in new string[] { "CACHE", "CONFIG", "DATA" }) {
+            var path = Path.build_filename (this.root, name.down ());
+            DirUtils.create_with_parents (path, 0755);
+            launcher.setenv ("XDG_%s_HOME".printf (name), path, true);
+        }
+
+        string[] argv = { rygel_path, "--config", config_path };
+        if (plugin_path != null) {
+            argv += "--plugin-path";
+            argv += plugin_path;
+        }
+        if (engine_path != null) {
+            argv += "--engine-path";
+            argv += engine_path;
+        }
+
+        this.daemon = launcher.spawnv (argv);
+        this.pid = this.daemon.get_identifier ();
+        this.daemon.wait_async.begin (null, (object, res) => {
+            this.exited = true;
+        });
+    }
+
+    /**
+     * Wait until the server answers.
+     */
+    private async void wait_for_daemon () throws Error {
+        var deadline = get_monotonic_time () + 30 * TimeSpan.SECOND;
+        while (true) {
+            try {
+                yield this.call (0,
+                                 "Browse",
+                                 { "ObjectID", "0",
+                                   "BrowseFlag", "BrowseMetadata",
+                                   "Filter", "*",
+                                   "StartingIndex", "0",
+                                   "RequestedCount", "0",
+                                   "SortCriteria", "" });
+
+                return;
+            } catch (Error error) {
+                if (this.exited) {
+                    throw new BenchmarkError.FAILED ("Rygel exited early");
+                }
+
+                if (get_monotonic_time () > deadline) {
+                    throw new BenchmarkError.TIMEOUT
+                                        ("Rygel did not start: %s",
+                                         error.message);
+                }
+            }
+
+            yield this.sleep (100);
+        }
+    }
+
+    private async void stop_daemon () {
+        if (this.daemon == null || this.exited) {
+            return;
+        }
+
+        this.daemon.send_signal (ProcessSignal.TERM);
+
+        var killed = false;
+        var id = Timeout.add_seconds (10, () => {
+            killed = true;
+            this.daemon.force_exit ();
+
+            return false;
+        });
+
+        try {
+            yield this.daemon.wait_async (null);
+        } catch (Error error) { }
+
+        if (!killed) {
+            Source.remove (id);
+        }
+    }
+
+    private async void sleep (uint milliseconds) {
+        Timeout.add (milliseconds, this.sleep.callback);
+        yield;
+    }
+
+    /**
+     * Wait until all files are in the database, by searching for all items.
+     */
+    private async void wait_for_harvest (int         expected,
+                                         Operation   harvest) throws Error {
+        var deadline = get_monotonic_time () +
+                       harvest_timeout * TimeSpan.SECOND;
+
+        while (true) {
+            var result = yield this.call
+                                        (0,
+                                         "Search",
+                                         { "ContainerID", "0",
+                                           "SearchCriteria",
+                                           "upnp:class derivedfrom " +
+                                           "\"object.item\"",
+                                           "Filter", "dc:title",
+                                           "StartingIndex", "0",
+                                           "RequestedCount", "1",
+                                           "SortCriteria", "" });
+            if (result.total >= expected) {
+                harvest.count = result.total;
+                harvest.bytes = (int64) items * file_size * 1024 +
+                                (int64) streams * stream_size * 1024 * 1024;
+
+                return;
+            }
+
+            if (get_monotonic_time () > deadline) {
+                // MediaExport needs mx-extract, which is only run from the
+                // build directory with -Duninstalled=true
+                throw new BenchmarkError.TIMEOUT
+                                        ("Only %u of %d files harvested",
+                                         result.total,
+                                         expected);
+            }
+
+            yield this.sleep (250);
+        }
+    }
+
+    private async void find_streams () throws Error {
+        var result = yield this.call (0,
+                                      "Search",
+                                      { "ContainerID", "0",
+                                        "SearchCriteria",
+                                        "dc:title contains \"Stream\"",
+                                        "Filter", "*",
+                                        "StartingIndex", "0",
+                                        "RequestedCount", "0",
+                                        "SortCriteria", "+dc:title" });
+
+        var parser = new GUPnP.DIDLLiteParser ();
+        parser.item_available.connect ((item) => {
+            foreach (var resource in item.get_resources ()) {
+                if (resource.uri.has_prefix ("http://")) {
+                    this.stream_uris.add (resource.uri);
+
+                    break;
+                }
+            }
+        });
+        parser.parse_didl (result.didl);
+
+        if (this.stream_uris.size < streams) {
+            throw new BenchmarkError.FAILED ("Only found %d of %d streams",
+                                             this.stream_uris.size,
+                                             streams);
+        }
+    }
+
+    /**
+     * Run @operation on all clients at once.
+     */
+    private async void run_clients (Operation operation) throws Error {
+        var running = clients;
+        Error failure = null;
+        SourceFunc callback = this.run_clients.callback;
+
+        operation.begin (this.pid);
+        for (var i = 0; i < clients; i++) {
+            this.run_client.begin (operation, i, (object, res) => {
+                try {
+                    this.run_client.end (res);
+                } catch (Error error) {
+                    failure = error.copy ();
+                }
+
+                if (--running == 0) {
+                    callback ();
+                }
+            });
+        }
+        yield;
+        operation.end (this.pid);
+
+        if (failure != null) {
+            throw failure.copy ();
+        }
+    }
+
+    private async void run_client (Operation operation,
+                                   int       client) throws Error {
+        switch (operation.name) {
+        case "browse":
+            yield this.browse_all (operation, client);
+            break;
+        case "search":
+            yield this.search (operation, client);
+            break;
+        case "range-get":
+            yield this.request_ranges (operation, client);
+            break;
+        default:
+            assert_not_reached ();
+        }
+    }
+
+    /**
+     * Browse all containers from the root, page by page.
+     */
+    private async void browse_all (Operation operation,
+                                   int       client) throws Error {
+        var pending = new LinkedList<string> ();
+        pending.add ("0");
+
+        var parser = new GUPnP.DIDLLiteParser ();
+        parser.container_available.connect ((container) => {
+            pending.add (container.id);
+        });
+
+        while (!pending.is_empty) {
+            var id = pending.poll_head ();
+            uint offset = 0;
+            SearchResult result = null;
+
+            do {
+                var start = get_monotonic_time ();
+                result = yield this.call (client,
+                                          "Browse",
+                                          { "ObjectID", id,
+                                            "BrowseFlag",
+                                            "BrowseDirectChildren",
+                                            "Filter", "*",
+                                            "StartingIndex",
+                                            offset.to_string (),
+                                            "RequestedCount",
+                                            PAGE_SIZE.to_string (),
+                                            "SortCriteria", "" });
+                operation.add (get_monotonic_time () - start,
+                               result.didl.length);
+
+                parser.parse_didl (result.didl);
+                offset += result.returned;
+            } while (result.returned > 0 && offset < result.total);
+        }
+    }
+
+    private async void search (Operation operation,
+                               int       client) throws Error {
+        var albums = int.max (items / TRACKS_PER_ALBUM, 1);
+
+        for (var round = 0; round < rounds; round++) {
+            // Different clients look at different parts of the library
+            var page = client * rounds + round;
+            var album = page % albums;
+
+            string[] queries = {
+                "upnp:class derivedfrom \"object.item.audioItem\"",
+                "upnp:class derivedfrom \"object.item.videoItem\"",
+                "dc:title contains \"Track %04d\"".printf (album),
+                "upnp:class derivedfrom \"object.item\" and " +
+                "dc:title contains \"%d\"".printf (round)
+            };
+
+            for (var i = 0; i < queries.length; i++) {
+                // Only the first query has enough results to page through
+                var offset = i == 0 ? page * PAGE_SIZE % items : 0;
+
+                var start = get_monotonic_time ();
+                var result = yield this.call
+                                        (client,
+                                         "Search",
+                                         { "ContainerID", "0",
+                                           "SearchCriteria", queries[i],
+                                           "Filter", "*",
+                                           "StartingIndex",
+                                           offset.to_string (),
+                                           "RequestedCount",
+                                           PAGE_SIZE.to_string (),
+                                           "SortCriteria", "+dc:title" });
+                operation.add (get_monotonic_time () - start,
+                               result.didl.length);
+            }
+        }
+    }
+
+    private async void request_ranges (Operation operation,
+                                       int       client) throws Error {
+        var random = new Rand.with_seed (client);
+        var length = range_size * 1024;
+        var size = stream_size * 1024 * 1024;
+        var buffer = new uint8[READ_SIZE];
+
+        for (var i = 0; i < requests; i++) {
+            var uri = this.stream_uris[(client + i) % this.stream_uris.size];
+            var offset = random.int_range (0, int.max (size - length, 1));
+
+            var message = new Soup.Message ("GET", uri);
+            message.request_headers.set_range (offset, offset + length - 1);
+
+            var start = get_monotonic_time ();
+            var stream = yield this.sessions[client].send_async
+                                        (message, Priority.DEFAULT, null);
+            if (message.status_code != Soup.Status.PARTIAL_CONTENT) {
+                throw new BenchmarkError.FAILED ("Range request failed: %u %s",
+                                                 message.status_code,
+                                                 message.reason_phrase);
+            }
+
+            int64 received = 0;
+            ssize_t read;
+            while ((read = yield stream.read_async (buffer)) > 0) {
+                received += read;
+            }
+            yield stream.close_async ();
+
+            operation.add (get_monotonic_time () - start, received);
+        }
+    }
+
+    /**
+     * Invoke a ContentDirectory action on behalf of @client.
+     *
+     * @param arguments pairs of argument names and values
+     */
+    private async SearchResult call (int      client,
+                                     string   action,
+                                     string[] arguments) throws Error {
+        var builder = new StringBuilder ();
+        for (var i = 0; i + 1 < arguments.length; i += 2) {
+            builder.append_printf ("<%s>%s</%s>",
+                                   arguments[i],
+                                   Markup.escape_text (arguments[i + 1]),
+                                   arguments[i]);
+        }
+
+        var envelope = "<?xml version=\"1.0\" encoding=\"utf-8\"?>" +
+                       "<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/" +
+                       "soap/envelope/\" s:encodingStyle=\"http://schemas." +
+                       "xmlsoap.org/soap/encoding/\"><s:Body>" +
+                       "<u:%s xmlns:u=\"%s\">%s</u:%s></s:Body></s:Envelope>";
+        var body = envelope.printf (action,
+                                    CONTENT_DIRECTORY,
+                                    builder.str,
+                                    action);
+
+        var message = new Soup.Message ("POST", this.control_url);
+        message.request_headers.append ("SOAPAction",
+                                        "\"%s#%s\"".printf (CONTENT_DIRECTORY,
+                                                            action));
+        message.set_request_body_from_bytes ("text/xml; charset=\"utf-8\"",
+                                             new Bytes (body.data));
+
+        var response = yield this.sessions[client].send_and_read_async
+                                        (message, Priority.DEFAULT, null);
+        if (message.status_code != Soup.Status.OK) {
+            throw new BenchmarkError.FAILED ("%s failed: %u %s",
+                                             action,
+                                             message.status_code,
+                                             message.reason_phrase);
+        }
+
+        Xml.Doc* doc = Xml.Parser.read_memory
+                                        ((string) response.get_data (),
+                                         (int) response.get_size (),
+                                         null,
+                                         null,
+                                         Xml.ParserOption.NONET);
+        if (doc == null) {
+            throw new BenchmarkError.FAILED ("Invalid reply to %s", action);
+        }
+
+        var result = new SearchResult ();
+        var root = doc->get_root_element ();
+        result.didl = this.find_value (root, "Result") ?? "";
+        result.returned = (uint) uint64.parse
+                                        (this.find_value (root,
+                                                          "NumberReturned") ??
+                                         "0");
+        result.total = (uint) uint64.parse
+                                        (this.find_value (root,
+                                                          "TotalMatches") ??
+                                         "0");
+        delete doc;
+
+        return result;
+    }
+
+    private string? find_value (Xml.Node* node, string name) {
+        for (var child = node; child != null; child = child->next) {
+            if (child->type == Xml.ElementType.ELEMENT_NODE &&
+                child->name == name) {
+                return child->get_content ();
+            }
+
+            var value = this.find_value (child->children, name);
+            if (value != null) {
+                return value;
+            }
+        }
+
+        return null;
+    }
+}
+
+int main (string[] args) {
+    try {
+        var context = new OptionContext ("- benchmark the media server");
+        context.add_main_entries (options, null);
+        context.parse (ref args);
+    } catch (OptionError error) {
+        printerr ("%s\n", error.message);
+
+        return 2;
+    }
+
+    if (items < 1 || streams < 1 || clients < 1 ||
+        range_size > stream_size * 1024) {
+        printerr ("Invalid arguments\n");
+
+        return 2;
+    }
+
+    return new MediaServerBenchmark ().run ();
+}
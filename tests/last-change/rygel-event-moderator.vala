@@ -0,0 +1 @@
+../../src/librygel-server/rygel-event-moderator.vala
\ No newline at end of file
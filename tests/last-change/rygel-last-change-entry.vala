@@ -0,0 +1 @@
+../../src/librygel-server/rygel-last-change-entry.vala
\ No newline at end of file
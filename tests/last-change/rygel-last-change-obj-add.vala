@@ -0,0 +1 @@
+../../src/librygel-server/rygel-last-change-obj-add.vala
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/librygel-server/rygel-last-change-st-done.vala
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/librygel-server/rygel-last-change.vala
\ No newline at end of file
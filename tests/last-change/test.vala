@@ -0,0 +1,106 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Rygel;
+
+private const string FOOTER = "</StateEvent>";
+
+private const uint MIN_INTERVAL = 50;
+private const uint MAX_INTERVAL = 400;
+
+public void test_last_change () {
+    var last_change = new LastChange ();
+    var empty = last_change.get_log ();
+    assert (empty.has_suffix (FOOTER));
+    var header = empty.substring (0, empty.length - FOOTER.length);
+
+    var added = new LastChangeObjAdd ("1", 1, false, "0", "object.item");
+    var done = new LastChangeStDone ("0", 2);
+    last_change.add_event (added);
+    last_change.add_event (done);
+    assert (last_change.get_log () ==
+            header + added.to_string () + done.to_string () + FOOTER);
+
+    // The log stays as it is until the next event comes in
+    last_change.clear_on_new_event ();
+    assert (last_change.get_log () ==
+            header + added.to_string () + done.to_string () + FOOTER);
+
+    var next = new LastChangeObjAdd ("2", 3, true, "0", "object.container");
+    last_change.add_event (next);
+    assert (last_change.get_log () == header + next.to_string () + FOOTER);
+
+    last_change.add_event (done);
+    assert (last_change.get_log () ==
+            header + next.to_string () + done.to_string () + FOOTER);
+}
+
+/**
+ * Schedule an event and wait for it.
+ *
+ * @return the time until it was sent in milliseconds
+ */
+private int64 wait_for_event (EventModerator moderator) {
+    var loop = new MainLoop ();
+    var handler = moderator.send.connect (() => { loop.quit (); });
+
+    var start = get_monotonic_time ();
+    moderator.schedule ();
+    // Already pending, so this changes nothing
+    moderator.schedule ();
+    loop.run ();
+    moderator.disconnect (handler);
+
+    return (get_monotonic_time () - start) / 1000;
+}
+
+private void wait (uint interval) {
+    var loop = new MainLoop ();
+    Timeout.add (interval, () => { loop.quit (); return false; });
+    loop.run ();
+}
+
+public void test_event_moderator () {
+    var moderator = new EventModerator (MIN_INTERVAL, MAX_INTERVAL);
+
+    assert (wait_for_event (moderator) >= MIN_INTERVAL);
+
+    // Changes right after each event double the interval up to the maximum
+    assert (wait_for_event (moderator) >= MIN_INTERVAL * 2);
+    assert (wait_for_event (moderator) >= MIN_INTERVAL * 4);
+    assert (wait_for_event (moderator) >= MAX_INTERVAL);
+    var capped = wait_for_event (moderator);
+    assert (capped >= MAX_INTERVAL);
+    assert (capped < MAX_INTERVAL * 2);
+
+    // A whole interval without changes drops it back to the minimum
+    wait (MAX_INTERVAL + MIN_INTERVAL);
+    var reset = wait_for_event (moderator);
+    assert (reset >= MIN_INTERVAL);
+    assert (reset < MAX_INTERVAL);
+}
+
+int main (string[] args) {
+    Test.init (ref args);
+
+    Test.add_func ("/librygel-server/last-change", test_last_change);
+    Test.add_func ("/librygel-server/event-moderator",
+                   test_event_moderator);
+
+    return Test.run ();
+}
@@ -44,11 +44,227 @@ public void test_bgo683926_1 () {
     }
 }
 
+/**
+ * Test that prepared statements are re-used and that nested cursors on the
+ * same SQL do not interfere with each other.
+ */
+public void test_statement_cache () {
+    Rygel.Database.Database db = null;
+    const string SQL = "SELECT id FROM object WHERE id >= ? ORDER BY id";
+
+    try {
+        db = new Rygel.Database.Database (":memory:");
+        db.exec ("create table object (id text not null);");
+        db.exec ("insert into object (id) VALUES ('a');");
+        db.exec ("insert into object (id) VALUES ('b');");
+    } catch (Error e) {
+        error ("=> Database preparation failed: %s", e.message);
+    }
+
+    try {
+        Value[] args = { "a" };
+        var outer_rows = 0;
+        var inner_rows = 0;
+
+        var misses = db.statement_cache_misses;
+        var cursor = db.exec_cursor (SQL, args);
+        foreach (var statement in cursor) {
+            outer_rows++;
+            Value[] inner_args = { statement.column_text (0) };
+            var inner = db.exec_cursor (SQL, inner_args);
+            foreach (var inner_statement in inner) {
+                inner_rows++;
+            }
+        }
+        cursor = null;
+
+        assert (outer_rows == 2);
+        assert (inner_rows == 3);
+        assert (db.statement_cache_misses == misses + 2);
+
+        var hits = db.statement_cache_hits;
+        Value[] b_args = { "b" };
+        assert (db.query_value ("SELECT count(*) FROM object WHERE id >= ?",
+                                b_args) == 1);
+        assert (db.statement_cache_hits == hits);
+        assert (db.query_value ("SELECT count(*) FROM object WHERE id >= ?",
+                                args) == 2);
+        assert (db.statement_cache_hits == hits + 1);
+    } catch (Error e) {
+        error ("=> Statement cache test failed: %s", e.message);
+    }
+}
+
+/**
+ * Test that read () runs on the read-only connections of the workers and
+ * sees what was committed on the writing connection.
+ */
+public void test_read_pool () {
+    Rygel.Database.Database db = null;
+    string dir = null;
+
+    try {
+        dir = DirUtils.make_tmp ("rygel-database-test-XXXXXX");
+        var path = Path.build_filename (dir, "test.db");
+        db = new Rygel.Database.Database
+                                    (path,
+                                     Rygel.Database.Flavor.FOREIGN,
+                                     Rygel.Database.Flags.READ_WRITE |
+                                     Rygel.Database.Flags.SHARED);
+        db.exec ("create table object (id text not null);");
+        db.exec ("insert into object (id) VALUES ('a');");
+        db.start_readers (2);
+        db.exec ("insert into object (id) VALUES ('b');");
+    } catch (Error e) {
+        error ("=> Database preparation failed: %s", e.message);
+    }
+
+    var loop = new MainLoop ();
+    var pending = 4;
+    for (var i = 0; i < 4; i++) {
+        var count = 0;
+        var read_only = false;
+        db.read.begin ((connection) => {
+            count = connection.query_value ("SELECT count(*) FROM object");
+            try {
+                connection.exec ("insert into object (id) VALUES ('c');");
+            } catch (Error e) {
+                read_only = true;
+            }
+        }, null, (object, res) => {
+            try {
+                db.read.end (res);
+            } catch (Error e) {
+                error ("=> Read failed: %s", e.message);
+            }
+
+            assert (count == 2);
+            assert (read_only);
+            if (--pending == 0) {
+                loop.quit ();
+            }
+        });
+    }
+    loop.run ();
+
+    // Without workers, reads run on the writing connection
+    db.stop_readers ();
+    var writable = false;
+    db.read.begin ((connection) => {
+        connection.exec ("insert into object (id) VALUES ('c');");
+        writable = true;
+    }, null, (object, res) => {
+        try {
+            db.read.end (res);
+        } catch (Error e) {
+            error ("=> Read failed: %s", e.message);
+        }
+
+        loop.quit ();
+    });
+    loop.run ();
+    assert (writable);
+
+    db = null;
+    try {
+        var directory = Dir.open (dir);
+        string name;
+        while ((name = directory.read_name ()) != null) {
+            FileUtils.unlink (Path.build_filename (dir, name));
+        }
+    } catch (Error e) { }
+    DirUtils.remove (dir);
+}
+
+/**
+ * Test the typed bind functions and that a row snapshot keeps all columns
+ * after the statement moved on.
+ */
+public void test_typed_bind () {
+    Rygel.Database.Database db = null;
+
+    try {
+        db = new Rygel.Database.Database (":memory:");
+        db.exec ("create table object (id text, size integer, title text);");
+    } catch (Error e) {
+        error ("=> Database preparation failed: %s", e.message);
+    }
+
+    try {
+        var cursor = db.prepare ("insert into object VALUES (?, ?, ?);");
+        cursor.bind_text (1, "a");
+        cursor.bind_int64 (2, int64.MAX);
+        cursor.bind_text (3, null);
+        cursor.run ();
+
+        cursor = db.prepare ("insert into object VALUES (?, ?, ?);");
+        cursor.bind_text (1, "b");
+        cursor.bind_null (2);
+        cursor.bind_text (3, "Title");
+        cursor.run ();
+        cursor = null;
+
+        var rows = new Gee.ArrayList<Rygel.Database.Row> ();
+        foreach (var statement in db.exec_cursor
+                                        ("SELECT * FROM object ORDER BY id")) {
+            rows.add (new Rygel.Database.RowSnapshot (statement));
+        }
+
+        assert (rows.size == 2);
+        assert (rows[0].column_text (0) == "a");
+        assert (rows[0].column_int64 (1) == int64.MAX);
+        assert (rows[0].column_text (1) == int64.MAX.to_string ());
+        assert (rows[0].column_type (2) == Sqlite.NULL);
+        assert (rows[0].column_text (2) == null);
+        assert (rows[1].column_text (0) == "b");
+        assert (rows[1].column_type (1) == Sqlite.NULL);
+        assert (rows[1].column_text (2) == "Title");
+    } catch (Error e) {
+        error ("=> Typed bind test failed: %s", e.message);
+    }
+}
+
+/**
+ * Test that the profile counts the statements by the label in their leading
+ * comment.
+ */
+public void test_profile () {
+    Rygel.Database.Database db = null;
+    const string SQL = "/* COUNT */ SELECT count(*) FROM object WHERE id >= ?";
+
+    try {
+        db = new Rygel.Database.Database (":memory:");
+        db.exec ("create table object (id text not null);");
+        db.exec ("insert into object (id) VALUES ('a');");
+        db.profile = new Rygel.Database.Profile ();
+
+        Value[] args = { "a" };
+        assert (db.query_value (SQL, args) == 1);
+        assert (db.query_value (SQL, args) == 1);
+    } catch (Error e) {
+        error ("=> Profile test failed: %s", e.message);
+    }
+
+    var statistics = db.profile.get_statistics ();
+    var count = statistics.lookup_value ("COUNT", null);
+    assert (count != null);
+    assert (count.lookup_value ("count", null).get_uint64 () == 2);
+    assert (count.lookup_value ("rows", null).get_uint64 () == 2);
+}
+
 int main (string[] args) {
     Test.init (ref args);
 
     Test.add_func ("/librygel-db/regression/bgo689326_1",
                    test_bgo683926_1);
+    Test.add_func ("/librygel-db/statement-cache",
+                   test_statement_cache);
+    Test.add_func ("/librygel-db/read-pool",
+                   test_read_pool);
+    Test.add_func ("/librygel-db/typed-bind",
+                   test_typed_bind);
+    Test.add_func ("/librygel-db/profile",
+                   test_profile);
 
     return Test.run ();
 }
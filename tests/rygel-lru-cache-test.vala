@@ -0,0 +1,81 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Rygel;
+
+public void test_capacity () {
+    var cache = new LruCache<string, string> (3);
+
+    cache["a"] = "1";
+    cache["b"] = "2";
+    cache["c"] = "3";
+    assert (cache.size == 3);
+
+    // Using an entry saves it from being dropped next
+    assert (cache["a"] == "1");
+    cache["d"] = "4";
+    assert (cache.size == 3);
+    assert (!cache.has_key ("b"));
+    assert (cache["a"] == "1");
+
+    // So does replacing it
+    cache["c"] = "5";
+    cache["e"] = "6";
+    assert (!cache.has_key ("d"));
+    assert (cache["c"] == "5");
+    assert (cache["e"] == "6");
+    assert (cache["d"] == null);
+}
+
+public void test_evict () {
+    var cache = new LruCache<string, string> ();
+
+    cache["a"] = "1";
+    cache["b"] = "2";
+    cache["c"] = "3";
+
+    string value;
+    assert (cache.unset ("b", out value));
+    assert (value == "2");
+    assert (!cache.unset ("b"));
+
+    assert (cache.evict (out value));
+    assert (value == "1");
+    assert (cache.evict (out value));
+    assert (value == "3");
+    assert (!cache.evict ());
+    assert (cache.is_empty);
+
+    cache["a"] = "1";
+    cache.clear ();
+    assert (cache.is_empty);
+    assert (!cache.evict ());
+
+    cache["b"] = "2";
+    assert (cache.evict (out value));
+    assert (value == "2");
+}
+
+int main (string[] args) {
+    Test.init (ref args);
+
+    Test.add_func ("/librygel-core/lru-cache/capacity", test_capacity);
+    Test.add_func ("/librygel-core/lru-cache/evict", test_evict);
+
+    return Test.run ();
+}
@@ -0,0 +1,236 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Rygel.Database;
+using Rygel.MediaExport;
+
+/**
+ * Create the schema the same way MediaCache.create_schema () does.
+ */
+private Database create_database (SQLFactory sql) {
+    Database db = null;
+
+    try {
+        db = new Database (":memory:");
+        db.exec (sql.make (SQLString.SCHEMA));
+        db.exec (sql.make (SQLString.TRIGGER_COMMON));
+        db.exec (sql.make (SQLString.TABLE_HIERARCHY));
+        db.exec (sql.make (SQLString.INDEX_COMMON));
+        db.exec (sql.make (SQLString.TRIGGER_HIERARCHY));
+        GLib.Value[] args = { sql.hierarchy.get_name () };
+        db.exec (sql.make (SQLString.SET_HIERARCHY), args);
+        db.exec (sql.make (SQLString.TRIGGER_REFERENCE));
+        db.exec (sql.make (SQLString.TRIGGER_FILE_IDENTITY));
+        db.exec (sql.make (SQLString.TRIGGER_AGGREGATE));
+    } catch (Error e) {
+        error ("=> Failed to create schema: %s", e.message);
+    }
+
+    return db;
+}
+
+/**
+ * Save an object the way MediaCache does, with INSERT OR REPLACE.
+ */
+private void save (Database db, SQLFactory sql, string id, string? parent) {
+    GLib.Value parent_value;
+    if (parent == null) {
+        parent_value = Database.@null ();
+    } else {
+        parent_value = parent;
+    }
+
+    GLib.Value[] args = { id,
+                          id,
+                          0,
+                          parent_value,
+                          (int64) 0,
+                          Database.@null (),
+                          0,
+                          -1,
+                          -1,
+                          0,
+                          Database.@null () };
+
+    try {
+        db.exec (sql.make (SQLString.INSERT), args);
+    } catch (Error e) {
+        error ("=> Failed to save %s: %s", id, e.message);
+    }
+}
+
+/**
+ * Count @id and all of its descendants.
+ */
+private int count_descendants (Database db, SQLFactory sql, string id) {
+    var query = sql.make
+                    (SQLString.GET_OBJECT_COUNT_BY_FILTER_WITH_ANCESTOR);
+    GLib.Value[] args = { id };
+
+    try {
+        return db.query_value (query.printf (""), args);
+    } catch (Error e) {
+        error ("=> Failed to count descendants of %s: %s", id, e.message);
+    }
+}
+
+private void delete_subtree (Database db, SQLFactory sql, string id) {
+    GLib.Value[] args = { id };
+
+    try {
+        db.exec (sql.make (SQLString.DELETE), args);
+    } catch (Error e) {
+        error ("=> Failed to delete %s: %s", id, e.message);
+    }
+}
+
+private int count_objects (Database db) {
+    try {
+        return db.query_value ("SELECT COUNT(*) FROM Object");
+    } catch (Error e) {
+        error ("=> Failed to count objects: %s", e.message);
+    }
+}
+
+/**
+ * Build the tree
+ *
+ *   0 ─┬─ a ── b ── c
+ *      └─ d
+ *
+ * and check what each container has below it, then delete a subtree.
+ */
+private void check_descendants (Hierarchy hierarchy) {
+    var sql = new SQLFactory ();
+    sql.hierarchy = hierarchy;
+    var db = create_database (sql);
+
+    save (db, sql, "0", null);
+    save (db, sql, "a", "0");
+    save (db, sql, "b", "a");
+    save (db, sql, "c", "b");
+    save (db, sql, "d", "0");
+
+    assert (count_descendants (db, sql, "0") == 5);
+    assert (count_descendants (db, sql, "a") == 3);
+    assert (count_descendants (db, sql, "b") == 2);
+    assert (count_descendants (db, sql, "c") == 1);
+    assert (count_descendants (db, sql, "d") == 1);
+
+    // Saving an object again must not detach its children
+    save (db, sql, "b", "a");
+    assert (count_descendants (db, sql, "a") == 3);
+    assert (count_descendants (db, sql, "b") == 2);
+
+    delete_subtree (db, sql, "a");
+    assert (count_objects (db) == 2);
+    assert (count_descendants (db, sql, "0") == 2);
+    assert (count_descendants (db, sql, "a") == 0);
+}
+
+public void test_closure_descendants () {
+    check_descendants (Hierarchy.CLOSURE);
+}
+
+public void test_path_descendants () {
+    check_descendants (Hierarchy.PATH);
+}
+
+/**
+ * Saving an object with a new parent moves its whole subtree along.
+ */
+public void test_path_move () {
+    var sql = new SQLFactory ();
+    sql.hierarchy = Hierarchy.PATH;
+    var db = create_database (sql);
+
+    save (db, sql, "0", null);
+    save (db, sql, "a", "0");
+    save (db, sql, "b", "a");
+    save (db, sql, "c", "b");
+    save (db, sql, "d", "0");
+
+    save (db, sql, "b", "d");
+    assert (count_descendants (db, sql, "0") == 5);
+    assert (count_descendants (db, sql, "a") == 1);
+    assert (count_descendants (db, sql, "d") == 3);
+
+    // New children of a moved object end up below its new position
+    save (db, sql, "e", "c");
+    assert (count_descendants (db, sql, "d") == 4);
+    assert (count_descendants (db, sql, "a") == 1);
+
+    // And back again
+    save (db, sql, "b", "a");
+    assert (count_descendants (db, sql, "a") == 4);
+    assert (count_descendants (db, sql, "d") == 1);
+
+    delete_subtree (db, sql, "a");
+    assert (count_objects (db) == 2);
+    assert (count_descendants (db, sql, "d") == 1);
+}
+
+/**
+ * Converting to the path hierarchy fills it from the existing objects,
+ * and the triggers carry on from there.
+ */
+public void test_path_fill () {
+    var sql = new SQLFactory ();
+    sql.hierarchy = Hierarchy.CLOSURE;
+    var db = create_database (sql);
+
+    save (db, sql, "0", null);
+    save (db, sql, "a", "0");
+    save (db, sql, "b", "a");
+    save (db, sql, "c", "b");
+    save (db, sql, "d", "0");
+
+    try {
+        db.exec (sql.make (SQLString.DROP_HIERARCHY));
+        sql.hierarchy = Hierarchy.PATH;
+        db.exec (sql.make (SQLString.TABLE_HIERARCHY));
+        db.exec (sql.make (SQLString.FILL_HIERARCHY));
+        db.exec (sql.make (SQLString.TRIGGER_HIERARCHY));
+    } catch (Error e) {
+        error ("=> Failed to convert hierarchy: %s", e.message);
+    }
+
+    assert (count_descendants (db, sql, "0") == 5);
+    assert (count_descendants (db, sql, "a") == 3);
+    assert (count_descendants (db, sql, "d") == 1);
+
+    save (db, sql, "e", "c");
+    save (db, sql, "c", "d");
+    assert (count_descendants (db, sql, "a") == 2);
+    assert (count_descendants (db, sql, "d") == 3);
+}
+
+int main (string[] args) {
+    Test.init (ref args);
+
+    Test.add_func ("/media-export/hierarchy/closure/descendants",
+                   test_closure_descendants);
+    Test.add_func ("/media-export/hierarchy/path/descendants",
+                   test_path_descendants);
+    Test.add_func ("/media-export/hierarchy/path/move",
+                   test_path_move);
+    Test.add_func ("/media-export/hierarchy/path/fill",
+                   test_path_fill);
+
+    return Test.run ();
+}
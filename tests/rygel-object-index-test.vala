@@ -0,0 +1,193 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Rygel;
+
+/**
+ * A root container that does not hand out its children, so find_object ()
+ * only finds what is in the object index.
+ */
+public class IndexOnlyContainer : SimpleContainer {
+    public IndexOnlyContainer () {
+        Object (id : "0",
+                parent : null,
+                title : "Root",
+                child_count : 0);
+    }
+
+    public override async MediaObjects? get_children
+                                        (uint         offset,
+                                         uint         max_count,
+                                         string       sort_criteria,
+                                         Cancellable? cancellable)
+                                         throws Error {
+        return new MediaObjects ();
+    }
+}
+
+private MediaObject? find (MediaContainer root, string id) {
+    var loop = new MainLoop ();
+    MediaObject? result = null;
+
+    root.find_object.begin (id, null, (object, res) => {
+        try {
+            result = root.find_object.end (res);
+        } catch (Error error) {
+            assert_not_reached ();
+        }
+
+        loop.quit ();
+    });
+    loop.run ();
+
+    return result;
+}
+
+public void test_add_remove () {
+    var root = new IndexOnlyContainer ();
+    var item = new ImageItem ("item", root, "Item");
+    var folder = new SimpleContainer ("folder", root, "Folder");
+    var nested = new ImageItem ("nested", folder, "Nested");
+
+    folder.add_child_item (nested);
+    root.add_child_item (item);
+    root.add_child_container (folder);
+
+    assert (find (root, "item") == item);
+    assert (find (root, "folder") == folder);
+    assert (find (root, "nested") == nested);
+
+    // Removing a container takes everything below it along
+    root.remove_child (folder);
+    assert (find (root, "folder") == null);
+    assert (find (root, "nested") == null);
+    assert (find (root, "item") == item);
+
+    root.remove_child (item);
+    assert (find (root, "item") == null);
+}
+
+public void test_clear () {
+    var root = new IndexOnlyContainer ();
+    var folder = new SimpleContainer ("folder", root, "Folder");
+    var nested = new ImageItem ("nested", folder, "Nested");
+
+    folder.add_child_item (nested);
+    root.add_child_item (new ImageItem ("item", root, "Item"));
+    root.add_child_container (folder);
+
+    root.clear ();
+    assert (find (root, "item") == null);
+    assert (find (root, "folder") == null);
+    assert (find (root, "nested") == null);
+}
+
+public void test_destruction () {
+    var root = new IndexOnlyContainer ();
+
+    // Not added to the root, but its children still know where they are
+    SimpleContainer? folder = new SimpleContainer ("folder", root, "Folder");
+    folder.add_child_item (new ImageItem ("nested", folder, "Nested"));
+    assert (find (root, "nested") != null);
+
+    folder = null;
+    assert (find (root, "nested") == null);
+}
+
+public void test_direct_removal () {
+    var root = new IndexOnlyContainer ();
+    ImageItem? item = new ImageItem ("item", root, "Item");
+
+    root.add_child_item (item);
+    assert (find (root, "item") == item);
+
+    // Dropped behind the container's back, so the index is not told
+    root.children.remove (item);
+    item = null;
+    assert (find (root, "item") == null);
+
+    // The stale entry does not get in the way of a new object
+    var replacement = new ImageItem ("item", root, "Replacement");
+    root.add_child_item (replacement);
+    assert (find (root, "item") == replacement);
+}
+
+public void test_empty_children () {
+    var root = new IndexOnlyContainer ();
+    var folder = new SimpleContainer ("folder", root, "Folder");
+    var nested = new ImageItem ("nested", folder, "Nested");
+
+    // Empty containers are held back until they have children
+    root.add_child_container (folder);
+    assert (find (root, "folder") == null);
+
+    folder.add_child_item (nested);
+    folder.updated ();
+    assert (find (root, "folder") == folder);
+    assert (find (root, "nested") == nested);
+
+    folder.remove_child (nested);
+    folder.updated ();
+    assert (find (root, "folder") == null);
+    assert (find (root, "nested") == null);
+
+    folder.add_child_item (nested);
+    folder.updated ();
+    assert (find (root, "folder") == folder);
+    assert (find (root, "nested") == nested);
+}
+
+public void test_shared_id () {
+    var first_root = new IndexOnlyContainer ();
+    var second_root = new IndexOnlyContainer ();
+    var first = new ImageItem ("item", first_root, "First");
+    var second = new ImageItem ("item", second_root, "Second");
+
+    first_root.add_child_item (first);
+    second_root.add_child_item (second);
+    assert (find (first_root, "item") == first);
+    assert (find (second_root, "item") == second);
+
+    second_root.remove_child (second);
+    assert (find (first_root, "item") == first);
+    assert (find (second_root, "item") == null);
+
+    second_root.add_child_item (second);
+    first_root.remove_child (first);
+    assert (find (first_root, "item") == null);
+    assert (find (second_root, "item") == second);
+}
+
+int main (string[] args) {
+    Test.init (ref args);
+
+    Test.add_func ("/librygel-server/object-index/add-remove",
+                   test_add_remove);
+    Test.add_func ("/librygel-server/object-index/clear",
+                   test_clear);
+    Test.add_func ("/librygel-server/object-index/destruction",
+                   test_destruction);
+    Test.add_func ("/librygel-server/object-index/direct-removal",
+                   test_direct_removal);
+    Test.add_func ("/librygel-server/object-index/empty-children",
+                   test_empty_children);
+    Test.add_func ("/librygel-server/object-index/shared-id",
+                   test_shared_id);
+
+    return Test.run ();
+}
@@ -0,0 +1 @@
+../../src/librygel-server/rygel-logical-expression.vala
\ No newline at end of file
@@ -0,0 +1 @@
+../../src/librygel-server/rygel-relational-expression.vala
\ No newline at end of file
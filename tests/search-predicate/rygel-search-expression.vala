@@ -0,0 +1 @@
+../../src/librygel-server/rygel-search-expression.vala
\ No newline at end of file
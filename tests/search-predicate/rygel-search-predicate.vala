@@ -0,0 +1 @@
+../../src/librygel-server/rygel-search-predicate.vala
\ No newline at end of file
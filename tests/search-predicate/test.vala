@@ -0,0 +1,351 @@
+/*
+ * This file is part of Rygel.
+ *
+ * Rygel is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Rygel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+using Gee;
+using GUPnP;
+
+public class Rygel.MediaObject : Object {
+    public string id;
+    public string ref_id;
+    public string upnp_class;
+    public string title;
+    public uint object_update_id;
+    public MediaContainer parent;
+}
+
+public class Rygel.MediaContainer : MediaObject {
+    public int child_count;
+    public uint update_id;
+}
+
+public interface Rygel.TrackableContainer : MediaContainer {
+}
+
+public interface Rygel.TrackableItem : MediaObject {
+}
+
+public interface Rygel.WritableContainer : MediaContainer {
+    public abstract ArrayList<string> create_classes { get; set; }
+}
+
+public class Rygel.MusicItem : MediaObject {
+    public string artist;
+    public string album;
+}
+
+public class Rygel.PhotoItem : MediaObject {
+    public string creator;
+}
+
+public class Rygel.TestTrackableContainer : MediaContainer,
+                                            TrackableContainer {
+}
+
+public class Rygel.TestTrackableItem : MusicItem, TrackableItem {
+}
+
+public class Rygel.TestWritableContainer : MediaContainer,
+                                           WritableContainer {
+    public ArrayList<string> create_classes { get; set; }
+
+    public TestWritableContainer () {
+        this.create_classes = new ArrayList<string> ();
+    }
+}
+
+public class Rygel.SearchPredicateTest : Object {
+    private const string[] PROPERTIES = {
+        "@id",
+        "@refID",
+        "@parentID",
+        "upnp:class",
+        "dc:title",
+        "upnp:objectUpdateID",
+        "upnp:containerUpdateID",
+        "upnp:createClass",
+        "dc:creator",
+        "upnp:artist",
+        "upnp:album",
+        "@childCount",
+        "upnp:genre"
+    };
+
+    private const SearchCriteriaOp[] OPERATORS = {
+        SearchCriteriaOp.EQ,
+        SearchCriteriaOp.NEQ,
+        SearchCriteriaOp.LESS,
+        SearchCriteriaOp.LEQ,
+        SearchCriteriaOp.GREATER,
+        SearchCriteriaOp.GEQ,
+        SearchCriteriaOp.CONTAINS,
+        SearchCriteriaOp.DOES_NOT_CONTAIN,
+        SearchCriteriaOp.DERIVED_FROM,
+        SearchCriteriaOp.EXISTS
+    };
+
+    private const string[] OPERANDS = {
+        "true",
+        "false",
+        "",
+        "-1",
+        "0",
+        "3",
+        "7",
+        "10",
+        "object",
+        "object.item",
+        "Object.Container",
+        "object.item.audioItem.musicTrack",
+        "OBJECT.ITEM.IMAGEITEM.PHOTO",
+        "object.itemx",
+        "music",
+        "Title",
+        "title 10",
+        "artist",
+        "ref"
+    };
+
+    private ArrayList<MediaObject> objects;
+
+    public SearchPredicateTest () {
+        this.objects = new ArrayList<MediaObject> ();
+
+        // A parent without an id, so @parentID of its children is null
+        var anonymous = new MediaContainer ();
+
+        // Nothing set at all
+        var bare = new MediaObject ();
+        bare.parent = anonymous;
+        this.objects.add (bare);
+
+        var root = new MediaContainer ();
+        root.id = "0";
+        root.upnp_class = "object.container";
+        root.title = "Root";
+        root.child_count = 7;
+        root.update_id = 3;
+        root.parent = anonymous;
+        this.objects.add (root);
+
+        var music = new MusicItem ();
+        music.id = "music";
+        music.ref_id = "ref";
+        music.upnp_class = "object.item.audioItem.musicTrack";
+        music.title = "Title 10";
+        music.object_update_id = 10;
+        music.artist = "Artist";
+        music.parent = root;
+        this.objects.add (music);
+
+        var photo = new PhotoItem ();
+        photo.id = "photo";
+        photo.upnp_class = "object.item.imageItem.photo";
+        photo.title = "title";
+        photo.creator = "Artist";
+        photo.parent = root;
+        this.objects.add (photo);
+
+        var anonymous_photo = new PhotoItem ();
+        anonymous_photo.id = "anonymous-photo";
+        anonymous_photo.upnp_class = "object.item.imageItem.photo";
+        anonymous_photo.parent = root;
+        this.objects.add (anonymous_photo);
+
+        var trackable_item = new TestTrackableItem ();
+        trackable_item.id = "trackable-item";
+        trackable_item.upnp_class = "object.item.audioItem.musicTrack";
+        trackable_item.title = "";
+        trackable_item.object_update_id = 3;
+        trackable_item.artist = "ARTIST";
+        trackable_item.album = "Music";
+        trackable_item.parent = root;
+        this.objects.add (trackable_item);
+
+        var trackable = new TestTrackableContainer ();
+        trackable.id = "trackable";
+        trackable.upnp_class = "object.container.storageFolder";
+        trackable.title = "Music";
+        trackable.object_update_id = 7;
+        trackable.update_id = 10;
+        trackable.parent = root;
+        this.objects.add (trackable);
+
+        var writable = new TestWritableContainer ();
+        writable.id = "writable";
+        writable.upnp_class = "object.container";
+        writable.title = "Writable";
+        writable.child_count = -1;
+        writable.create_classes.add ("object.item.audioItem");
+        writable.create_classes.add ("object.container");
+        writable.parent = root;
+        this.objects.add (writable);
+
+        var read_only = new TestWritableContainer ();
+        read_only.id = "read-only";
+        read_only.upnp_class = "object.container";
+        read_only.parent = writable;
+        this.objects.add (read_only);
+    }
+
+    public static int main (string[] args) {
+        Test.init (ref args);
+
+        var test = new SearchPredicateTest ();
+
+        Test.add_data_func ("/librygel-server/search-predicate/relational",
+                            test.test_relational);
+        Test.add_data_func ("/librygel-server/search-predicate/logical",
+                            test.test_logical);
+
+        return Test.run ();
+    }
+
+    /**
+     * matches () gives the same result as satisfied_by () for every
+     * property, operator and object.
+     */
+    public void test_relational () {
+        foreach (var property in PROPERTIES) {
+            foreach (var op in OPERATORS) {
+                foreach (var operand in OPERANDS) {
+                    var expression = new RelationalExpression ();
+                    expression.operand1 = property;
+                    expression.op = op;
+                    expression.operand2 = operand;
+
+                    this.check (expression);
+                }
+            }
+        }
+    }
+
+    /**
+     * And the same for expressions joined with and and or.
+     */
+    public void test_logical () {
+        var operands = new ArrayList<SearchExpression> ();
+        operands.add (this.relational ("upnp:class",
+                                       SearchCriteriaOp.DERIVED_FROM,
+                                       "object.item"));
+        operands.add (this.relational ("dc:title",
+                                       SearchCriteriaOp.CONTAINS,
+                                       "title"));
+        operands.add (this.relational ("upnp:objectUpdateID",
+                                       SearchCriteriaOp.EXISTS,
+                                       "true"));
+        operands.add (this.relational ("@childCount",
+                                       SearchCriteriaOp.GREATER,
+                                       "0"));
+
+        foreach (var op in new LogicalOperator[] { LogicalOperator.AND,
+                                                   LogicalOperator.OR }) {
+            foreach (var left in operands) {
+                foreach (var right in operands) {
+                    var expression = new LogicalExpression ();
+                    expression.op = op;
+                    expression.operand1 = left;
+                    expression.operand2 = right;
+                    this.check (expression);
+
+                    var nested = new LogicalExpression ();
+                    if (op == LogicalOperator.AND) {
+                        nested.op = LogicalOperator.OR;
+                    } else {
+                        nested.op = LogicalOperator.AND;
+                    }
+                    nested.operand1 = expression;
+                    nested.operand2 = left;
+                    this.check (nested);
+                }
+            }
+        }
+    }
+
+    private RelationalExpression relational (string           property,
+                                             SearchCriteriaOp op,
+                                             string           operand) {
+        var expression = new RelationalExpression ();
+        expression.operand1 = property;
+        expression.op = op;
+        expression.operand2 = operand;
+
+        return expression;
+    }
+
+    private void check (SearchExpression expression) {
+        var predicate = SearchPredicate.compile (expression);
+
+        foreach (var object in this.objects) {
+            var matches = predicate.matches (object);
+            if (this.is_unset_substring_test (expression, object)) {
+                assert (!matches);
+
+                continue;
+            }
+
+            if (matches != expression.satisfied_by (object)) {
+                error ("%s on %s: matches () is %s",
+                       expression.to_string (),
+                       object.id ?? "(null)",
+                       matches.to_string ());
+            }
+        }
+    }
+
+    /**
+     * satisfied_by () calls string functions on null for contains and
+     * derivedFrom if the property is not set, so it cannot be compared
+     * there. The predicate does not match then.
+     */
+    private bool is_unset_substring_test (SearchExpression expression,
+                                          MediaObject      object) {
+        var relational = expression as RelationalExpression;
+        if (relational == null ||
+            (relational.op != SearchCriteriaOp.CONTAINS &&
+             relational.op != SearchCriteriaOp.DERIVED_FROM)) {
+            return false;
+        }
+
+        switch (relational.operand1) {
+        case "@id":
+            return object.id == null;
+        case "@refID":
+            return object.ref_id == null;
+        case "@parentID":
+            return object.parent.id == null;
+        case "upnp:class":
+            return object.upnp_class == null;
+        case "dc:title":
+            return object.title == null;
+        case "dc:creator":
+            var photo = object as PhotoItem;
+
+            return photo != null && photo.creator == null;
+        case "upnp:artist":
+            var music = object as MusicItem;
+
+            return music != null && music.artist == null;
+        case "upnp:album":
+            var music = object as MusicItem;
+
+            return music != null && music.album == null;
+        default:
+            return false;
+        }
+    }
+}
@@ -47,7 +47,7 @@ public class MediaContainer : MediaObject {
     public int all_child_count {
         get { return this.child_count; }
     }
-    public async MediaObjects? get_children (
+    public virtual async MediaObjects? get_children (
                                             uint offset,
                                             uint max_count,
                                             string sort_criteria,
@@ -120,7 +120,8 @@ public class TestContainer : MediaContainer, Rygel.SearchableContainer {
         try
         {
             var result = yield search (null, 10, 4, "", null, out total_matches);
-            assert (total_matches == 0);
+            // Not enough matches to stop early, so all were counted
+            assert (total_matches == 10);
             assert (result.size == 0);
         } catch (GLib.Error error) {
             assert_not_reached ();
@@ -129,7 +130,7 @@ public class TestContainer : MediaContainer, Rygel.SearchableContainer {
         for (int i = 1; i < 10; ++i) {
             try {
                 var result = yield search (null, i, 3, "", null, out total_matches);
-                assert (total_matches == 0);
+                assert (total_matches == (i + 3 > 10 ? 10 : 0));
                 assert (result.size == int.min (10 - i, 3));
             } catch (GLib.Error error) {
                 assert_not_reached ();
@@ -139,6 +140,39 @@ public class TestContainer : MediaContainer, Rygel.SearchableContainer {
         this.loop.quit ();
     }
 
+    public async void test_search_order () {
+        uint total_matches;
+
+        // The first child container is the last to finish its search
+        var parent = new ParentContainer ();
+        parent.children.add (new DelayedContainer (30));
+        parent.children.add (new MediaObject ());
+        parent.children.add (new DelayedContainer (20));
+        parent.children.add (new DelayedContainer (10));
+
+        var expected = new MediaObjects ();
+        expected.add_all (parent.children);
+        foreach (var child in parent.children) {
+            if (child is DelayedContainer) {
+                expected.add_all ((child as DelayedContainer).results);
+            }
+        }
+
+        try {
+            var result = yield parent.search (null, 0, 0, "", null,
+                                              out total_matches);
+            assert (total_matches == expected.size);
+            assert (result.size == expected.size);
+            for (int i = 0; i < expected.size; ++i) {
+                assert (result[i] == expected[i]);
+            }
+        } catch (GLib.Error error) {
+            assert_not_reached ();
+        }
+
+        this.loop.quit ();
+    }
+
     /* TODO: This is just here to avoid a warning about
      * serialize_search_parameters() not being used.
      * How should this really be tested?
@@ -166,6 +200,92 @@ public class TestContainer : MediaContainer, Rygel.SearchableContainer {
 
 }
 
+/**
+ * A container with a fixed list of children.
+ */
+public class ParentContainer : MediaContainer, Rygel.SearchableContainer {
+    public MediaObjects children = new MediaObjects ();
+    public Gee.ArrayList<string> search_classes { get; set; default = new
+        Gee.ArrayList<string> ();}
+
+    public override async MediaObjects? get_children (
+                                            uint offset,
+                                            uint max_count,
+                                            string sort_criteria,
+                                            Cancellable? cancellable)
+                                            throws Error {
+        return this.children;
+    }
+
+    public async MediaObjects? search (SearchExpression? expression,
+                                       uint              offset,
+                                       uint              max_count,
+                                       string            sort_criteria,
+                                       Cancellable?      cancellable,
+                                       out uint          total_matches)
+                                       throws Error {
+        return yield this.simple_search (expression,
+                                         offset,
+                                         max_count,
+                                         sort_criteria,
+                                         cancellable,
+                                         out total_matches);
+    }
+}
+
+/**
+ * A container that takes @delay milliseconds to search.
+ */
+public class DelayedContainer : MediaContainer, Rygel.SearchableContainer {
+    public MediaObjects results = new MediaObjects ();
+    public Gee.ArrayList<string> search_classes { get; set; default = new
+        Gee.ArrayList<string> ();}
+
+    private uint delay;
+
+    public DelayedContainer (uint delay) {
+        this.delay = delay;
+        for (int i = 0; i < 3; ++i) {
+            this.results.add (new MediaObject ());
+        }
+    }
+
+    public async MediaObjects? search (SearchExpression? expression,
+                                       uint              offset,
+                                       uint              max_count,
+                                       string            sort_criteria,
+                                       Cancellable?      cancellable,
+                                       out uint          total_matches)
+                                       throws Error {
+        Timeout.add (this.delay, () => { search.callback (); return false; });
+        yield;
+
+        total_matches = this.results.size;
+
+        return this.results;
+    }
+}
+
+public class ObjectIndex : Object {
+    public static ObjectIndex get_default () {
+        return new ObjectIndex ();
+    }
+
+    public MediaObject? lookup (string id, MediaContainer root) {
+        return null;
+    }
+}
+
+public class SearchPredicate : Object {
+    public static SearchPredicate compile (SearchExpression expression) {
+        return new SearchPredicate ();
+    }
+
+    public bool matches (MediaObject object) {
+        return true;
+    }
+}
+
 public class MediaObjects : Gee.ArrayList<MediaObject> {
     public override Gee.List<MediaObject>? slice (int start, int stop) {
         var slice = base.slice (start, stop);
@@ -185,6 +305,8 @@ int main ()
     c.loop.run ();
     c.test_search_with_limit.begin ();
     c.loop.run ();
+    c.test_search_order.begin ();
+    c.loop.run ();
 
     return 0;
 }